@@ -0,0 +1,42 @@
+/**
+ * \file Block.hpp
+ *
+ * Implements a block for use in an unrolled linked list. Each block
+ * holds up to block_capacity pointers to elements in one array, with
+ * a count of how many are in use, and a pointer to the next block.
+ * Walking the list touches one block per block_capacity elements.
+ */
+
+#ifndef BLOCK_HPP
+#define BLOCK_HPP
+
+#include "Cell.hpp"
+
+/**
+ * \brief The number of elements a block can hold. With the count and
+ * the next pointer, a block takes two 64 byte cache lines.
+ */
+const int block_capacity = 14;
+
+/**
+ * \class Block
+ * \brief A block within an unrolled linked list.
+ */
+typedef struct Block {
+  int count_m;
+  Block* next_m;
+  Cell* elems_m[block_capacity];
+} Block;
+
+/**
+ * \class UnrolledList
+ * \brief An unrolled linked list: its first and last blocks, and
+ * the number of elements in all of them.
+ */
+typedef struct UnrolledList {
+  Block* head_m;
+  Block* tail_m;
+  int size_m;
+} UnrolledList;
+
+#endif // BLOCK_HPP
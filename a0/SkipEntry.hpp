@@ -0,0 +1,54 @@
+/**
+ * \file SkipEntry.hpp
+ *
+ * Implements the entries of a skip list that indexes the elements of
+ * a linked list by position. Each entry stands for one node holding
+ * an element, and has a tower of links to later entries. Each link
+ * also records its width: how many positions it skips ahead.
+ */
+
+#ifndef SKIPENTRY_HPP
+#define SKIPENTRY_HPP
+
+#include "Node.hpp"
+
+/**
+ * \brief The most levels an index can have, enough for 2^32 elements.
+ */
+const int skip_max_height = 32;
+
+/**
+ * \class SkipLink
+ * \brief One level of an entry's tower.
+ */
+typedef struct SkipLink {
+  struct SkipEntry* next_m;
+  int width_m;
+} SkipLink;
+
+/**
+ * \class SkipEntry
+ * \brief An entry of the index. height_m links are allocated
+ * along with it.
+ */
+typedef struct SkipEntry {
+  Node* node_m;
+  int height_m;
+  SkipLink links_m[1];
+} SkipEntry;
+
+/**
+ * \class ListIndex
+ * \brief A skip list over the linked list with head list_m. Its
+ * head entry is at position -1 and has all skip_max_height links,
+ * of which the lowest height_m are in use.
+ */
+typedef struct ListIndex {
+  Node* list_m;
+  SkipEntry* head_m;
+  int height_m;
+  int size_m;
+  unsigned int seed_m;
+} ListIndex;
+
+#endif // SKIPENTRY_HPP
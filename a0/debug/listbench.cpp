@@ -0,0 +1,152 @@
+/**
+ * Where the skip list index starts paying off: random list_ith and
+ * positional insert/erase pairs on a plain Node list, against the same
+ * operations through a ListIndex, at list sizes from 4 to 65536.
+ * Then the large lists, 10^4 to 10^6 elements: building an
+ * UnrolledList and a ListIndex, and ulist_ith and ulist_insert/erase
+ * pairs at random positions. Build with
+ *   g++ -O2 listbench.cpp ../linkedlist.cpp ../unrolledlist.cpp ../listindex.cpp -o listbench
+ */
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include "../linkedlist.hpp"
+#include "../unrolledlist.hpp"
+#include "../listindex.hpp"
+
+using namespace std;
+
+const int OPS = 20000;
+
+typedef chrono::steady_clock bench_clock;
+
+double elapsed_ns(bench_clock::time_point start) {
+  return chrono::duration<double, nano>(bench_clock::now() - start).count();
+}
+
+// volatile keeps the lookups from being optimized away.
+volatile long sink;
+
+// a list of the ints 0 to n-1.
+Node* make_list(int n) {
+  Node* head = make_node(make_int(0), NULL);
+  Node* tail = head;
+  for (int i = 1; i < n; ++i) {
+    tail = list_insert_int(tail, NULL, i);
+  }
+  return head;
+}
+
+// the node at position i, walking from the head.
+Node* walk_to(Node* head, int i) {
+  Node* n = head;
+  while (i-- > 0) {
+    n = get_next(n);
+  }
+  return n;
+}
+
+int main() {
+  cout << "ns per operation" << endl;
+  cout << setw(8) << "size" << setw(12) << "list_ith" << setw(12) << "index_ith"
+       << setw(12) << "list_ins" << setw(12) << "index_ins" << endl;
+  for (int n = 4; n <= 65536; n *= 2) {
+    srand(n);
+    int* positions = new int[OPS];
+    for (int k = 0; k < OPS; ++k) {
+      positions[k] = rand() % n;
+    }
+
+    Node* plain = make_list(n);
+    long sum = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for (int k = 0; k < OPS; ++k) {
+      sum += get_int(list_ith(plain, positions[k]));
+    }
+    double plain_ith = elapsed_ns(start) / OPS;
+    // insert before position i, then erase it again. the
+    // walk is what a caller without an index has to do.
+    start = bench_clock::now();
+    for (int k = 0; k < OPS; ++k) {
+      int i = positions[k];
+      Node* pos = walk_to(plain, i);
+      list_insert_int(pos, pos, k);
+      if (i == 0) {
+        list_erase(plain, plain);
+      }
+      else {
+        Node* prev = walk_to(plain, i - 1);
+        list_erase(prev, get_next(prev));
+      }
+    }
+    double plain_ins = elapsed_ns(start) / OPS;
+
+    Node* indexed = make_list(n);
+    ListIndex* idx = index_build(indexed);
+    start = bench_clock::now();
+    for (int k = 0; k < OPS; ++k) {
+      sum += get_int(index_ith(idx, positions[k]));
+    }
+    double index_ith_ns = elapsed_ns(start) / OPS;
+    start = bench_clock::now();
+    for (int k = 0; k < OPS; ++k) {
+      index_insert(idx, positions[k], make_int(k));
+      index_erase(idx, positions[k]);
+    }
+    double index_ins = elapsed_ns(start) / OPS;
+    index_free(idx);
+    sink = sum;
+    delete [] positions;
+
+    cout << setw(8) << n << fixed << setprecision(1)
+         << setw(12) << plain_ith << setw(12) << index_ith_ns
+         << setw(12) << plain_ins << setw(12) << index_ins << endl;
+  }
+
+  cout << endl << "ns per element built, ns per operation" << endl;
+  cout << setw(8) << "size" << setw(12) << "ulist_make" << setw(12) << "index_make"
+       << setw(12) << "ulist_ith" << setw(12) << "ulist_ins" << endl;
+  for (int n = 10000; n <= 1000000; n *= 10) {
+    // the walks are O(n/14), so fewer of them at larger sizes.
+    int ops = n <= 10000 ? OPS : OPS / (n / 10000);
+    srand(n);
+    int* positions = new int[ops];
+    for (int k = 0; k < ops; ++k) {
+      positions[k] = rand() % n;
+    }
+
+    bench_clock::time_point start = bench_clock::now();
+    UnrolledList* ulist = ulist_make();
+    for (int i = 0; i < n; ++i) {
+      ulist_push_back(ulist, make_int(i));
+    }
+    double ulist_build = elapsed_ns(start) / n;
+    long sum = 0;
+    start = bench_clock::now();
+    for (int k = 0; k < ops; ++k) {
+      sum += get_int(ulist_ith(ulist, positions[k]));
+    }
+    double ulist_ith_ns = elapsed_ns(start) / ops;
+    start = bench_clock::now();
+    for (int k = 0; k < ops; ++k) {
+      ulist_insert_int(ulist, positions[k], k);
+      ulist_erase(ulist, positions[k]);
+    }
+    double ulist_ins = elapsed_ns(start) / ops;
+    ulist_free(ulist);
+
+    Node* list = make_list(n);
+    start = bench_clock::now();
+    ListIndex* idx = index_build(list);
+    double index_build_ns = elapsed_ns(start) / n;
+    index_free(idx);
+    sink = sum;
+    delete [] positions;
+
+    cout << setw(8) << n << fixed << setprecision(1)
+         << setw(12) << ulist_build << setw(12) << index_build_ns
+         << setw(12) << ulist_ith_ns << setw(12) << ulist_ins << endl;
+  }
+  return 0;
+}
@@ -87,6 +87,18 @@ inline Node* make_node(Cell* my_elem, Node* my_next)
   return new_node;
 }
 
+/**
+ * \brief Free a cell made by one of the make functions.
+ * \param c The cell, whose symbol name is freed too. May be NULL.
+ */
+inline void free_cell(Cell* c)
+{
+  if (c && c->tag_m == type_symbol) {
+    free(c->symbol_m);
+  }
+  free(c);
+}
+
 /**
  * \brief Check if d points to an int node.
  * \return True iff d points to an int node.
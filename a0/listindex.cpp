@@ -0,0 +1,266 @@
+#include "listindex.hpp"
+
+/**
+ * \brief Make an index entry with my_height empty links.
+ * \param my_node Pointer to the node this entry stands for.
+ */
+static SkipEntry* make_entry(Node* my_node, int my_height) {
+  SkipEntry* new_entry =
+    (SkipEntry*)malloc(sizeof(SkipEntry) + (my_height - 1) * sizeof(SkipLink));
+  if (!new_entry) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  new_entry->node_m = my_node;
+  new_entry->height_m = my_height;
+  for (int k = 0; k < my_height; ++k) {
+    new_entry->links_m[k].next_m = NULL;
+    new_entry->links_m[k].width_m = 0;
+  }
+  return new_entry;
+}
+
+/**
+ * \brief Height of a new entry: each level above the first is
+ * taken with probability 1/2, from a xorshift generator.
+ */
+static int random_height(ListIndex* idx) {
+  unsigned int x = idx->seed_m;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  idx->seed_m = x;
+  int height = 1;
+  while (height < skip_max_height && (x & 1)) {
+    ++height;
+    x >>= 1;
+  }
+  return height;
+}
+
+/**
+ * \brief Find the last entry before position i on each level in
+ * use, and the positions of those entries.
+ */
+static void find_before(const ListIndex* idx, int i, SkipEntry** update, int* pos) {
+  SkipEntry* x = idx->head_m;
+  int p = -1;
+  for (int k = idx->height_m - 1; k >= 0; --k) {
+    while (x->links_m[k].next_m != NULL && p + x->links_m[k].width_m < i) {
+      p += x->links_m[k].width_m;
+      x = x->links_m[k].next_m;
+    }
+    update[k] = x;
+    pos[k] = p;
+  }
+}
+
+/**
+ * \brief The entry at position i, which must be in the list.
+ */
+static SkipEntry* entry_at(const ListIndex* idx, int i) {
+  SkipEntry* x = idx->head_m;
+  int p = -1;
+  for (int k = idx->height_m - 1; k >= 0; --k) {
+    while (x->links_m[k].next_m != NULL && p + x->links_m[k].width_m <= i) {
+      p += x->links_m[k].width_m;
+      x = x->links_m[k].next_m;
+    }
+  }
+  return x;
+}
+
+/**
+ * \brief Add an entry for node at position i. The entries
+ * from i on move one position up.
+ */
+static void skip_insert(ListIndex* idx, int i, Node* node) {
+  SkipEntry* update[skip_max_height];
+  int pos[skip_max_height];
+  int height = random_height(idx);
+  // new levels start out empty, skipping to the end.
+  for (int k = idx->height_m; k < height; ++k) {
+    idx->head_m->links_m[k].next_m = NULL;
+    idx->head_m->links_m[k].width_m = idx->size_m + 1;
+  }
+  if (height > idx->height_m) {
+    idx->height_m = height;
+  }
+  find_before(idx, i, update, pos);
+  SkipEntry* e = make_entry(node, height);
+  for (int k = 0; k < height; ++k) {
+    SkipLink* link = &update[k]->links_m[k];
+    e->links_m[k].next_m = link->next_m;
+    e->links_m[k].width_m = pos[k] + link->width_m + 1 - i;
+    link->next_m = e;
+    link->width_m = i - pos[k];
+  }
+  // higher links now skip over one more position.
+  for (int k = height; k < idx->height_m; ++k) {
+    ++update[k]->links_m[k].width_m;
+  }
+  ++idx->size_m;
+}
+
+/**
+ * \brief Remove the entry at position i. The entries
+ * after it move one position down.
+ */
+static void skip_erase(ListIndex* idx, int i) {
+  SkipEntry* update[skip_max_height];
+  int pos[skip_max_height];
+  find_before(idx, i, update, pos);
+  SkipEntry* e = update[0]->links_m[0].next_m;
+  for (int k = 0; k < idx->height_m; ++k) {
+    SkipLink* link = &update[k]->links_m[k];
+    if (link->next_m == e) {
+      link->width_m += e->links_m[k].width_m - 1;
+      link->next_m = e->links_m[k].next_m;
+    }
+    else {
+      --link->width_m;
+    }
+  }
+  while (idx->height_m > 1 && idx->head_m->links_m[idx->height_m - 1].next_m == NULL) {
+    --idx->height_m;
+  }
+  --idx->size_m;
+  free(e);
+}
+
+ListIndex* index_build(Node* n) {
+  if (n == NULL) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  ListIndex* idx = (ListIndex*)malloc(sizeof(ListIndex));
+  if (!idx) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  idx->list_m = n;
+  idx->head_m = make_entry(NULL, skip_max_height);
+  idx->height_m = 1;
+  idx->size_m = 0;
+  idx->seed_m = 2463534242u;
+  // the latest entry on each level, and its position.
+  SkipEntry* last[skip_max_height];
+  int last_pos[skip_max_height];
+  for (int k = 0; k < skip_max_height; ++k) {
+    last[k] = idx->head_m;
+    last_pos[k] = -1;
+  }
+  // append an entry for each element, in one pass.
+  for (Node* node = n; node != NULL; node = get_next(node)) {
+    if (get_elem(node) == NULL) {
+      continue;
+    }
+    int height = random_height(idx);
+    if (height > idx->height_m) {
+      idx->height_m = height;
+    }
+    SkipEntry* e = make_entry(node, height);
+    for (int k = 0; k < height; ++k) {
+      last[k]->links_m[k].next_m = e;
+      last[k]->links_m[k].width_m = idx->size_m - last_pos[k];
+      last[k] = e;
+      last_pos[k] = idx->size_m;
+    }
+    ++idx->size_m;
+  }
+  // the last links skip to the end.
+  for (int k = 0; k < idx->height_m; ++k) {
+    last[k]->links_m[k].width_m = idx->size_m - last_pos[k];
+  }
+  return idx;
+}
+
+void index_free(ListIndex* idx) {
+  SkipEntry* e = idx->head_m;
+  while (e != NULL) {
+    SkipEntry* next = e->links_m[0].next_m;
+    free(e);
+    e = next;
+  }
+  free(idx);
+}
+
+int index_size(const ListIndex* idx) {
+  return idx->size_m;
+}
+
+Node* index_node(const ListIndex* idx, unsigned int i) {
+  if (i >= (unsigned int)idx->size_m) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  return entry_at(idx, i)->node_m;
+}
+
+Cell* index_ith(const ListIndex* idx, unsigned int i) {
+  return get_elem(index_node(idx, i));
+}
+
+Node* index_insert(ListIndex* idx, unsigned int i, Cell* c) {
+  if (i > (unsigned int)idx->size_m || c == NULL) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  Node* head = idx->list_m;
+  if (i == 0) {
+    // like list_insert at the head: the head node takes the value,
+    // and what it held moves to a new node right after it.
+    Node* moved = make_node(get_elem(head), get_next(head));
+    head->elem_m = c;
+    head->next_m = moved;
+    if (get_elem(moved) != NULL) {
+      skip_insert(idx, 1, moved);
+    }
+    else {
+      skip_insert(idx, 0, head);
+    }
+    return head;
+  }
+  Node* prev = entry_at(idx, i - 1)->node_m;
+  Node* new_node = make_node(c, get_next(prev));
+  prev->next_m = new_node;
+  skip_insert(idx, i, new_node);
+  return new_node;
+}
+
+Node* index_erase(ListIndex* idx, unsigned int i) {
+  if (i >= (unsigned int)idx->size_m) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  Node* head = idx->list_m;
+  Node* pos = entry_at(idx, i)->node_m;
+  free_cell(get_elem(pos));
+  if (pos == head) {
+    // the head node stays, it takes over the next node's
+    // contents, or is left without an element.
+    Node* next_node = get_next(head);
+    if (next_node == NULL) {
+      head->elem_m = NULL;
+      skip_erase(idx, 0);
+    }
+    else {
+      head->elem_m = get_elem(next_node);
+      head->next_m = get_next(next_node);
+      skip_erase(idx, get_elem(next_node) != NULL ? 1 : 0);
+      free(next_node);
+    }
+  }
+  else {
+    // nodes without elements may lie between pos
+    // and the entry before it.
+    Node* prev = i == 0 ? head : entry_at(idx, i - 1)->node_m;
+    while (get_next(prev) != pos) {
+      prev = get_next(prev);
+    }
+    prev->next_m = get_next(pos);
+    free(pos);
+    skip_erase(idx, i);
+  }
+  return i < (unsigned int)idx->size_m ? entry_at(idx, i)->node_m : NULL;
+}
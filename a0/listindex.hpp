@@ -0,0 +1,64 @@
+/**
+ * \file listindex.hpp
+ *
+ * An optional index over a linked list from linkedlist.hpp, kept as
+ * a skip list whose links know how many elements they skip. With it,
+ * access, insertion and erasure at a position take O(log n) expected
+ * time instead of a walk from the head. Nodes without an element are
+ * left out, as list_ith skips them too.
+ *
+ * The list stays an ordinary Node list, and the list_* functions still
+ * work on it. But changes that don't go through the index leave it
+ * stale, so build a new one after them.
+ */
+
+#ifndef LISTINDEX_HPP
+#define LISTINDEX_HPP
+
+#include "SkipEntry.hpp"
+#include "linkedlist_internals.hpp"
+
+/**
+ * \brief Index the list with head n, which must not be NULL. An empty
+ * list is a single node without an element.
+ * \return Pointer to the new index
+ */
+ListIndex* index_build(Node* n);
+
+/**
+ * \brief Free the index, but not the list it indexes.
+ */
+void index_free(ListIndex* idx);
+
+/**
+ * \brief Number of elements in the indexed list
+ * \return List size
+ */
+int index_size(const ListIndex* idx);
+
+/**
+ * \brief Node at the position i (starting from 0)
+ * \return Pointer to the node holding the value at position i
+ */
+Node* index_node(const ListIndex* idx, unsigned int i);
+
+/**
+ * \brief Value at the position i (starting from 0)
+ * \return Pointer to the value at position i in the list
+ */
+Cell* index_ith(const ListIndex* idx, unsigned int i);
+
+/**
+ * \brief Insert the value before the position i, or at the end if i
+ * is the size of the list. c must not be NULL.
+ * \return Pointer to the node holding the inserted value
+ */
+Node* index_insert(ListIndex* idx, unsigned int i, Cell* c);
+
+/**
+ * \brief Erase and free the value at the position i.
+ * \return Pointer to the node now holding position i, NULL if none
+ */
+Node* index_erase(ListIndex* idx, unsigned int i);
+
+#endif // LISTINDEX_HPP
@@ -1,5 +1,7 @@
 #include <iostream>
 #include "linkedlist.hpp"
+#include "unrolledlist.hpp"
+#include "listindex.hpp"
 
 int main(int argc, char** argv) {
   using namespace std;
@@ -99,6 +101,45 @@ int main(int argc, char** argv) {
   cout << *test_list << endl << *test_pos << endl;
   test_pos = list_insert(test_list, NULL, NULL);
   cout << *test_list << list_size(test_list) << endl;
+
+  // the unrolled list, with positions instead of nodes.
+  UnrolledList* ulist = ulist_make();
+  for (int i = 1; i <= 5; ++i) {
+    ulist_insert_int(ulist, ulist_size(ulist), i);
+    ulist_insert_double(ulist, 0, i * 0.1);
+  }
+  ulist_insert_symbol(ulist, 5, "mid");
+  cout << *ulist << ulist_size(ulist) << endl;
+  ulist_erase(ulist, 5);
+  ulist_erase(ulist, 0);
+  cout << *ulist << ulist_size(ulist) << " " << get_int(ulist_ith(ulist, 4)) << endl;
+  ulist_free(ulist);
+
+  // long lists neither recurse nor walk node by node. the
+  // timings at larger sizes are in debug/listbench.cpp.
+  const int long_size = 10000;
+  UnrolledList* long_ulist = ulist_make();
+  Node* long_list = make_node(make_int(0), NULL);
+  Node* long_tail = long_list;
+  for (int i = 1; i < long_size; ++i) {
+    ulist_push_back(long_ulist, make_int(i));
+    long_tail = list_insert_int(long_tail, NULL, i);
+  }
+  ulist_insert_int(long_ulist, 0, 0);
+  for (int i = 0; i < long_size / 2; ++i) {
+    ulist_erase(long_ulist, long_size / 4);
+  }
+  cout << list_size(long_list) << " " << get_int(list_ith(long_list, long_size - 1)) << " "
+       << ulist_size(long_ulist) << " " << get_int(ulist_ith(long_ulist, long_size / 4)) << endl;
+  ulist_free(long_ulist);
+
+  // an index over the long list, positions in O(log n).
+  ListIndex* long_index = index_build(long_list);
+  index_insert(long_index, long_size / 2, make_symbol("middle"));
+  index_erase(long_index, 0);
+  cout << index_size(long_index) << " " << get_symbol(index_ith(long_index, long_size / 2 - 1))
+       << " " << get_int(list_ith(long_list, 0)) << endl;
+  index_free(long_index);
   
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,203 @@
+#include "unrolledlist.hpp"
+
+/**
+ * \brief Make an empty block.
+ * \param my_next Pointer to the next block.
+ */
+static Block* make_block(Block* my_next) {
+  Block* new_block = (Block*)malloc(sizeof(Block));
+  if (!new_block) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  new_block->count_m = 0;
+  new_block->next_m = my_next;
+  return new_block;
+}
+
+/**
+ * \brief Find the block holding position i, and i's offset in it.
+ * An i at the end of a block is found in that block, not the next.
+ * \return The block, with prev set to the block before it.
+ */
+static Block* find_block(const UnrolledList* l, unsigned int& i, Block** prev) {
+  Block* b = l->head_m;
+  *prev = NULL;
+  while (b != NULL && i > (unsigned int)b->count_m) {
+    i -= b->count_m;
+    *prev = b;
+    b = b->next_m;
+  }
+  return b;
+}
+
+UnrolledList* ulist_make() {
+  UnrolledList* l = (UnrolledList*)malloc(sizeof(UnrolledList));
+  if (!l) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  l->head_m = NULL;
+  l->tail_m = NULL;
+  l->size_m = 0;
+  return l;
+}
+
+void ulist_free(UnrolledList* l) {
+  Block* b = l->head_m;
+  while (b != NULL) {
+    Block* next = b->next_m;
+    for (int j = 0; j < b->count_m; ++j) {
+      free_cell(b->elems_m[j]);
+    }
+    free(b);
+    b = next;
+  }
+  free(l);
+}
+
+int ulist_size(const UnrolledList* l) {
+  return l->size_m;
+}
+
+Cell* ulist_ith(const UnrolledList* l, unsigned int i) {
+  // skip whole blocks by their counts.
+  Block* b = l->head_m;
+  while (b != NULL && i >= (unsigned int)b->count_m) {
+    i -= b->count_m;
+    b = b->next_m;
+  }
+  if (b == NULL) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  return b->elems_m[i];
+}
+
+void ulist_push_back(UnrolledList* l, Cell* c) {
+  if (c == NULL) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  // a full last block gets a new one after it, so lists
+  // built from the front to the back have full blocks.
+  if (l->tail_m == NULL || l->tail_m->count_m == block_capacity) {
+    Block* b = make_block(NULL);
+    if (l->tail_m == NULL) {
+      l->head_m = b;
+    }
+    else {
+      l->tail_m->next_m = b;
+    }
+    l->tail_m = b;
+  }
+  l->tail_m->elems_m[l->tail_m->count_m++] = c;
+  ++l->size_m;
+}
+
+void ulist_insert(UnrolledList* l, unsigned int i, Cell* c) {
+  if (i > (unsigned int)l->size_m || c == NULL) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  if (i == (unsigned int)l->size_m) {
+    ulist_push_back(l, c);
+    return;
+  }
+  Block* prev;
+  Block* b = find_block(l, i, &prev);
+  if (b->count_m == block_capacity) {
+    // split the full block in halves, and insert
+    // into the one that holds position i.
+    Block* right = make_block(b->next_m);
+    int half = block_capacity / 2;
+    memcpy(right->elems_m, b->elems_m + half, (block_capacity - half) * sizeof(Cell*));
+    right->count_m = block_capacity - half;
+    b->count_m = half;
+    b->next_m = right;
+    if (l->tail_m == b) {
+      l->tail_m = right;
+    }
+    if (i > (unsigned int)half) {
+      i -= half;
+      b = right;
+    }
+  }
+  memmove(b->elems_m + i + 1, b->elems_m + i, (b->count_m - i) * sizeof(Cell*));
+  b->elems_m[i] = c;
+  ++b->count_m;
+  ++l->size_m;
+}
+
+void ulist_erase(UnrolledList* l, unsigned int i) {
+  if (i >= (unsigned int)l->size_m) {
+    std::cerr << "ERROR" << std::endl;
+    exit(1);
+  }
+  Block* prev;
+  Block* b = find_block(l, i, &prev);
+  // i can be at the end of a block, then it's the
+  // first element of the next one.
+  if (i == (unsigned int)b->count_m) {
+    prev = b;
+    b = b->next_m;
+    i = 0;
+  }
+  free_cell(b->elems_m[i]);
+  memmove(b->elems_m + i, b->elems_m + i + 1, (b->count_m - i - 1) * sizeof(Cell*));
+  --b->count_m;
+  --l->size_m;
+  if (b->count_m == 0) {
+    // unlink the empty block.
+    if (prev == NULL) {
+      l->head_m = b->next_m;
+    }
+    else {
+      prev->next_m = b->next_m;
+    }
+    if (l->tail_m == b) {
+      l->tail_m = prev;
+    }
+    free(b);
+  }
+  else if (b->next_m != NULL && b->count_m + b->next_m->count_m <= block_capacity / 2) {
+    // keep blocks at least a quarter full on average
+    // by merging two small neighbours.
+    Block* next = b->next_m;
+    memcpy(b->elems_m + b->count_m, next->elems_m, next->count_m * sizeof(Cell*));
+    b->count_m += next->count_m;
+    b->next_m = next->next_m;
+    if (l->tail_m == next) {
+      l->tail_m = b;
+    }
+    free(next);
+  }
+}
+
+void ulist_insert_int(UnrolledList* l, unsigned int i, const int value) {
+  ulist_insert(l, i, make_int(value));
+}
+
+void ulist_insert_double(UnrolledList* l, unsigned int i, const double value) {
+  ulist_insert(l, i, make_double(value));
+}
+
+void ulist_insert_symbol(UnrolledList* l, unsigned int i, const char* value) {
+  ulist_insert(l, i, make_symbol(value));
+}
+
+std::ostream& operator<<(std::ostream& os, const UnrolledList& l) {
+  Cell* elem = NULL;
+  os << "(";
+  for (const Block* b = l.head_m; b != NULL; b = b->next_m) {
+    for (int j = 0; j < b->count_m; ++j) {
+      elem = b->elems_m[j];
+      if (intp(elem)) {os << get_int(elem) << " ";}
+      else if (doublep(elem)) {os << get_double(elem) << " ";}
+      else if (symbolp(elem)) {os << get_symbol(elem) << " ";}
+    }
+  }
+  if (elem) {os << '\b';}
+  os << ")";
+  return os;
+}
@@ -0,0 +1,79 @@
+/**
+ * \file unrolledlist.hpp
+ *
+ * A sequence ADT like the one in linkedlist.hpp, kept as an unrolled
+ * linked list: each block holds several elements, so scans stay in
+ * cache and list_ith-style lookups skip whole blocks. Positions are
+ * indices rather than nodes, since elements move between blocks.
+ * None of the functions recurse, so lists can hold millions of
+ * elements.
+ */
+
+#ifndef UNROLLEDLIST_HPP
+#define UNROLLEDLIST_HPP
+
+#include "Block.hpp"
+#include "linkedlist_internals.hpp"
+
+/**
+ * \brief Make an empty unrolled list.
+ * \return Pointer to the new list
+ */
+UnrolledList* ulist_make();
+
+/**
+ * \brief Free the list l, its blocks and the elements in them.
+ */
+void ulist_free(UnrolledList* l);
+
+/**
+ * \brief Size of the list l
+ * \return List size
+ */
+int ulist_size(const UnrolledList* l);
+
+/**
+ * \brief Value at the position i (starting from 0)
+ * \return Pointer to the value at position i in the list
+ */
+Cell* ulist_ith(const UnrolledList* l, unsigned int i);
+
+/**
+ * \brief Erase the value at position i, and free it
+ */
+void ulist_erase(UnrolledList* l, unsigned int i);
+
+/**
+ * \brief Insert the value before the position i, or at the end
+ * if i is the size of the list. c must not be NULL.
+ */
+void ulist_insert(UnrolledList* l, unsigned int i, Cell* c);
+
+/**
+ * \brief Insert the value at the end of the list, in O(1)
+ */
+void ulist_push_back(UnrolledList* l, Cell* c);
+
+/**
+ * \brief Insert an int before the position i
+ */
+void ulist_insert_int(UnrolledList* l, unsigned int i, const int value);
+
+/**
+ * \brief Insert a double before the position i
+ */
+void ulist_insert_double(UnrolledList* l, unsigned int i, const double value);
+
+/**
+ * \brief Insert a symbol before the position i
+ */
+void ulist_insert_symbol(UnrolledList* l, unsigned int i, const char* value);
+
+/**
+ * \brief Print the list l in parentheses, the way a Node list prints.
+ * \param os The output stream to print to.
+ * \param l The list to be printed.
+ */
+std::ostream& operator<<(std::ostream& os, const UnrolledList& l);
+
+#endif // UNROLLEDLIST_HPP
@@ -0,0 +1,696 @@
+/**
+ * an ordered map kept as a B+ tree, with the same interface
+ * as bstmap. nodes are wide, a few cache lines of keys each,
+ * so a lookup touches about log_B n nodes instead of log_2 n.
+ * the keys of a node are stored together in one array and
+ * searched by a linear scan, which for numbers is branch free
+ * and left for the compiler to vectorize. all entries live in
+ * the leaves, which are chained, so iteration walks arrays.
+ *
+ * keys and values are kept apart, so dereferencing an iterator
+ * gives a pair of references rather than a stored pair. Key
+ * and T need to be default constructible and assignable.
+ */
+
+#ifndef BPTREEMAP_HPP
+#define BPTREEMAP_HPP
+
+#include <iterator>
+#include <type_traits>
+#include <utility>
+using namespace std;
+
+template <class Key, class T>
+class bptreemap
+{
+  typedef bptreemap<Key, T>     Self;
+
+public:
+  typedef Key                key_type;
+  typedef T                  data_type;
+  typedef T                  mapped_type;
+  typedef pair<const Key, T> value_type;
+  typedef unsigned int       size_type;
+  typedef int                difference_type;
+
+private:
+  // about node_bytes of keys in a node, and at least
+  // min_capacity. an even capacity lets two nodes at
+  // half capacity always merge into one.
+  static constexpr size_type node_bytes = 256;
+  static constexpr size_type min_capacity = 8;
+  static constexpr size_type capacity = (node_bytes / sizeof(Key) > min_capacity ?
+					 node_bytes / sizeof(Key) : min_capacity) & ~1u;
+  static constexpr size_type min_count = capacity / 2;
+  // deeper than any tree of 2^32 entries.
+  static constexpr size_type max_depth = 32;
+
+  /**
+   * \class NodeBase.
+   * \brief What leaves and inner nodes share: how many
+   * keys are in use, and which of the two it is.
+   */
+  struct NodeBase {
+    NodeBase(bool leaf): count(0), is_leaf(leaf) {}
+    size_type count;
+    bool is_leaf;
+  };
+
+  /**
+   * \class Leaf.
+   * \brief A leaf holds count entries in key order,
+   * and links to the leaves before and after it.
+   */
+  struct Leaf : NodeBase {
+    Leaf(): NodeBase(true), prev(NULL), next(NULL) {}
+    Key keys[capacity];
+    T values[capacity];
+    Leaf* prev;
+    Leaf* next;
+  };
+
+  /**
+   * \class Inner.
+   * \brief An inner node with count keys has count+1
+   * children. keys[i] is the smallest key under
+   * children[i+1].
+   */
+  struct Inner : NodeBase {
+    Inner(): NodeBase(false) {}
+    Key keys[capacity];
+    NodeBase* children[capacity + 1];
+  };
+
+  // the inner nodes a search went through, and which child it took.
+  struct Path {
+    Path(): depth(0) {}
+    Inner* nodes[max_depth];
+    size_type child[max_depth];
+    int depth;
+  };
+
+public:
+  template<typename Ref, typename Base_T>
+  class _iterator {
+  public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef typename bptreemap::value_type  value_type;
+    typedef int                             difference_type;
+    typedef Ref                             reference;
+
+    // what operator-> hands out: it holds the pair of
+    // references, and hands out a pointer to it in turn.
+    class pointer {
+    public:
+      pointer(const reference& r): ref_m(r) {}
+      reference* operator->() {
+	return &ref_m;
+      }
+    private:
+      reference ref_m;
+    };
+
+    friend class bptreemap;
+
+    _iterator(Base_T* map, Leaf* leaf=NULL, size_type index=0):
+      map_m(map), leaf_m(leaf), index_m(index) {}
+
+    bool operator==(const _iterator& x) const {
+      return leaf_m == x.leaf_m && index_m == x.index_m;
+    }
+
+    bool operator!=(const _iterator& x) const {
+      return !(*this == x);
+    }
+
+    reference operator*() const {
+      return reference(leaf_m->keys[index_m], leaf_m->values[index_m]);
+    }
+
+    pointer operator->() const {
+      return pointer(**this);
+    }
+
+    _iterator& operator++() {
+      if (++index_m == leaf_m->count) {
+	leaf_m = leaf_m->next;
+	index_m = 0;
+      }
+      return *this;
+    }
+
+    _iterator operator++(int) {
+      _iterator ret(*this);
+      ++(*this);
+      return ret;
+    }
+
+    // going back from end() gives the last element.
+    _iterator& operator--() {
+      if (leaf_m == NULL) {
+	leaf_m = map_m->last_m;
+	index_m = leaf_m->count - 1;
+      }
+      else if (index_m == 0) {
+	leaf_m = leaf_m->prev;
+	index_m = leaf_m->count - 1;
+      }
+      else {
+	--index_m;
+      }
+      return *this;
+    }
+
+    _iterator operator--(int) {
+      _iterator ret(*this);
+      --(*this);
+      return ret;
+    }
+
+  private:
+    Base_T* map_m;
+    Leaf* leaf_m;
+    size_type index_m;
+  };
+
+  typedef _iterator<pair<const Key&, T&>, bptreemap> iterator;
+  typedef _iterator<pair<const Key&, const T&>, const bptreemap> const_iterator;
+
+public:
+  // default constructor to create an empty map
+  bptreemap(): root_m(NULL), first_m(NULL), last_m(NULL), size_m(0) {}
+
+  // overload copy constructor to do a deep copy
+  bptreemap(const Self& x): root_m(NULL), first_m(NULL), last_m(NULL), size_m(0) {
+    _copy_from(x);
+  }
+
+  // move constructor, x is left empty.
+  bptreemap(Self&& x) noexcept:
+    root_m(x.root_m), first_m(x.first_m), last_m(x.last_m), size_m(x.size_m)
+  {
+    x._forget();
+  }
+
+  // destructor.
+  ~bptreemap() {
+    clear();
+  }
+
+  // overload assignment to do a deep copy
+  Self& operator=(const Self& x) {
+    // self assignment protection.
+    if (this != &x) {
+      clear();
+      _copy_from(x);
+    }
+    return *this;
+  }
+
+  // move assignment, x is left empty.
+  Self& operator=(Self&& x) noexcept {
+    if (this != &x) {
+      clear();
+      root_m = x.root_m;
+      first_m = x.first_m;
+      last_m = x.last_m;
+      size_m = x.size_m;
+      x._forget();
+    }
+    return *this;
+  }
+
+  void swap(Self& x) {
+    std::swap(root_m, x.root_m);
+    std::swap(first_m, x.first_m);
+    std::swap(last_m, x.last_m);
+    std::swap(size_m, x.size_m);
+  }
+
+  // accessors:
+  iterator begin() {
+    return iterator(this, first_m);
+  }
+  const_iterator begin() const {
+    return const_iterator(this, first_m);
+  }
+  iterator end() {
+    return iterator(this);
+  }
+  const_iterator end() const {
+    return const_iterator(this);
+  }
+  bool empty() const {
+    return size_m == 0;
+  }
+  size_type size() const {
+    return size_m;
+  }
+
+  // insert/erase
+  pair<iterator,bool> insert(const value_type& x) {
+    Path path;
+    Leaf* leaf = _find_leaf(x.first, &path);
+    if (leaf == NULL) {
+      // first time insert to an empty tree.
+      leaf = new Leaf;
+      root_m = first_m = last_m = leaf;
+    }
+    size_type i = _lower(leaf->keys, leaf->count, x.first);
+    if (i < leaf->count && !(x.first < leaf->keys[i])) {
+      // the key already exists.
+      return pair<iterator, bool>(iterator(this, leaf, i), false);
+    }
+    if (leaf->count == capacity) {
+      // split the leaf, and insert into the half the key falls in.
+      Leaf* right = _split_leaf(leaf, path);
+      if (i > leaf->count) {
+	i -= leaf->count;
+	leaf = right;
+      }
+    }
+    _shift_right(leaf->keys, i, leaf->count);
+    _shift_right(leaf->values, i, leaf->count);
+    leaf->keys[i] = x.first;
+    leaf->values[i] = x.second;
+    ++ leaf->count;
+    ++ size_m;
+    return pair<iterator, bool>(iterator(this, leaf, i), true);
+  }
+
+  void erase(iterator pos) {
+    if (pos.leaf_m != NULL) {
+      // the key moves while it's being erased.
+      Key k = pos.leaf_m->keys[pos.index_m];
+      erase(k);
+    }
+  }
+
+  size_type erase(const Key& x) {
+    Path path;
+    Leaf* leaf = _find_leaf(x, &path);
+    if (leaf == NULL) {
+      return 0;
+    }
+    size_type i = _lower(leaf->keys, leaf->count, x);
+    if (i == leaf->count || x < leaf->keys[i]) {
+      // the key's not found.
+      return 0;
+    }
+    _shift_left(leaf->keys, i + 1, leaf->count);
+    _shift_left(leaf->values, i + 1, leaf->count);
+    -- leaf->count;
+    -- size_m;
+    _rebalance(leaf, path);
+    return 1;
+  }
+
+  void clear() {
+    _delete_nodes(root_m);
+    _forget();
+  }
+
+  // map operations:
+  iterator find(const Key& x) {
+    pair<Leaf*, size_type> ret = _find(x);
+    return iterator(this, ret.first, ret.second);
+  }
+
+  const_iterator find(const Key& x) const {
+    pair<Leaf*, size_type> ret = _find(x);
+    return const_iterator(this, ret.first, ret.second);
+  }
+
+  size_type count(const Key& x) const {
+    return _find(x).first != NULL ? 1 : 0;
+  }
+
+  T& operator[](const Key& k) {
+    iterator it = insert(value_type(k, T())).first;
+    return it.leaf_m->values[it.index_m];
+  }
+
+private:
+  /**
+   * \brief the number of keys less than x, which is where
+   * x is or would go. numbers are compared all the way
+   * without branching, other keys stop at the first one
+   * that's not less.
+   */
+  static size_type _lower(const Key* keys, size_type count, const Key& x) {
+    size_type i = 0;
+    if (is_arithmetic<Key>::value) {
+      for (size_type j=0; j<count; ++j) {
+	i += keys[j] < x;
+      }
+    }
+    else {
+      while (i < count && keys[i] < x) ++i;
+    }
+    return i;
+  }
+
+  // the number of keys not greater than x, which
+  // is the child of an inner node to go down to.
+  static size_type _upper(const Key* keys, size_type count, const Key& x) {
+    size_type i = 0;
+    if (is_arithmetic<Key>::value) {
+      for (size_type j=0; j<count; ++j) {
+	i += !(x < keys[j]);
+      }
+    }
+    else {
+      while (i < count && !(x < keys[i])) ++i;
+    }
+    return i;
+  }
+
+  // move a[from, count) one place up or down.
+  template <class U>
+  static void _shift_right(U* a, size_type from, size_type count) {
+    for (size_type j=count; j>from; --j) {
+      a[j] = std::move(a[j - 1]);
+    }
+  }
+
+  template <class U>
+  static void _shift_left(U* a, size_type from, size_type count) {
+    for (size_type j=from; j<count; ++j) {
+      a[j - 1] = std::move(a[j]);
+    }
+  }
+
+  /**
+   * \brief go down to the leaf where x is or would be.
+   * \return the leaf, or NULL if the tree is empty. the
+   * inner nodes on the way are recorded in path.
+   */
+  Leaf* _find_leaf(const Key& x, Path* path) const {
+    NodeBase* node = root_m;
+    if (node == NULL) {
+      return NULL;
+    }
+    while (!node->is_leaf) {
+      Inner* inner = static_cast<Inner*>(node);
+      size_type c = _upper(inner->keys, inner->count, x);
+      if (path != NULL) {
+	path->nodes[path->depth] = inner;
+	path->child[path->depth] = c;
+	++ path->depth;
+      }
+      node = inner->children[c];
+    }
+    return static_cast<Leaf*>(node);
+  }
+
+  // the leaf and index of key x, or (NULL, 0) if it's not there.
+  pair<Leaf*, size_type> _find(const Key& x) const {
+    Leaf* leaf = _find_leaf(x, NULL);
+    if (leaf != NULL) {
+      size_type i = _lower(leaf->keys, leaf->count, x);
+      if (i < leaf->count && !(x < leaf->keys[i])) {
+	return pair<Leaf*, size_type>(leaf, i);
+      }
+    }
+    return pair<Leaf*, size_type>(NULL, 0);
+  }
+
+  /**
+   * \brief move the upper half of the full leaf into
+   * a new leaf after it, and add that to the parent.
+   * \return the new leaf.
+   */
+  Leaf* _split_leaf(Leaf* leaf, Path& path) {
+    Leaf* right = new Leaf;
+    size_type half = leaf->count / 2;
+    for (size_type j=half; j<leaf->count; ++j) {
+      right->keys[j - half] = std::move(leaf->keys[j]);
+      right->values[j - half] = std::move(leaf->values[j]);
+    }
+    right->count = leaf->count - half;
+    leaf->count = half;
+    // link the new leaf into the chain.
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next != NULL) {
+      leaf->next->prev = right;
+    }
+    else {
+      last_m = right;
+    }
+    leaf->next = right;
+    _insert_child(path, leaf, right->keys[0], right);
+    return right;
+  }
+
+  /**
+   * \brief add child right with smallest key k just after
+   * left, in the parent at the end of path, splitting
+   * the inner nodes up the path that are full.
+   */
+  void _insert_child(Path& path, NodeBase* left, const Key& k, NodeBase* right) {
+    if (path.depth == 0) {
+      // left was the root, the tree grows a level.
+      Inner* root = new Inner;
+      root->keys[0] = k;
+      root->children[0] = left;
+      root->children[1] = right;
+      root->count = 1;
+      root_m = root;
+      return;
+    }
+    -- path.depth;
+    Inner* parent = path.nodes[path.depth];
+    size_type c = path.child[path.depth];
+    if (parent->count < capacity) {
+      _shift_right(parent->keys, c, parent->count);
+      _shift_right(parent->children, c + 1, parent->count + 1);
+      parent->keys[c] = k;
+      parent->children[c + 1] = right;
+      ++ parent->count;
+      return;
+    }
+    // the parent is full. lay out its keys and children
+    // with the new ones, keep the lower half, move the
+    // upper half to a new node and the middle key up.
+    Key keys[capacity + 1];
+    NodeBase* children[capacity + 2];
+    for (size_type j=0, from=0; j<capacity+1; ++j) {
+      keys[j] = j == c ? k : std::move(parent->keys[from++]);
+    }
+    for (size_type j=0, from=0; j<capacity+2; ++j) {
+      children[j] = j == c + 1 ? right : parent->children[from++];
+    }
+    size_type mid = (capacity + 1) / 2;
+    Inner* sibling = new Inner;
+    parent->count = mid;
+    for (size_type j=0; j<mid; ++j) {
+      parent->keys[j] = std::move(keys[j]);
+    }
+    for (size_type j=0; j<=mid; ++j) {
+      parent->children[j] = children[j];
+    }
+    sibling->count = capacity - mid;
+    for (size_type j=0; j<sibling->count; ++j) {
+      sibling->keys[j] = std::move(keys[mid + 1 + j]);
+    }
+    for (size_type j=0; j<=sibling->count; ++j) {
+      sibling->children[j] = children[mid + 1 + j];
+    }
+    _insert_child(path, parent, keys[mid], sibling);
+  }
+
+  /**
+   * \brief after an erase from node, whose parents are on
+   * path, borrow from a sibling or merge with it if node
+   * has fallen under half full, and so on up the path.
+   */
+  void _rebalance(NodeBase* node, Path& path) {
+    while (path.depth > 0 && node->count < min_count) {
+      -- path.depth;
+      Inner* parent = path.nodes[path.depth];
+      size_type c = path.child[path.depth];
+      // work on the pair of children c-1, c or c, c+1.
+      size_type l = c > 0 ? c - 1 : c;
+      NodeBase* left = parent->children[l];
+      NodeBase* right = parent->children[l + 1];
+      NodeBase* sibling = left == node ? right : left;
+      if (sibling->count > min_count) {
+	if (node->is_leaf) {
+	  _borrow_leaf(static_cast<Leaf*>(left), static_cast<Leaf*>(right), parent, l);
+	}
+	else {
+	  _borrow_inner(static_cast<Inner*>(left), static_cast<Inner*>(right), parent, l);
+	}
+	return;
+      }
+      if (node->is_leaf) {
+	_merge_leaves(static_cast<Leaf*>(left), static_cast<Leaf*>(right));
+      }
+      else {
+	_merge_inners(static_cast<Inner*>(left), static_cast<Inner*>(right), parent->keys[l]);
+      }
+      // the separator and the right node leave the parent.
+      _shift_left(parent->keys, l + 1, parent->count);
+      _shift_left(parent->children, l + 2, parent->count + 1);
+      -- parent->count;
+      node = parent;
+    }
+    if (root_m->count == 0) {
+      // an empty root leaf goes, an inner root
+      // with one child hands over to it.
+      NodeBase* old = root_m;
+      if (old->is_leaf) {
+	root_m = first_m = last_m = NULL;
+	delete static_cast<Leaf*>(old);
+      }
+      else {
+	root_m = static_cast<Inner*>(old)->children[0];
+	delete static_cast<Inner*>(old);
+      }
+    }
+  }
+
+  // even out two neighbouring leaves, the separator
+  // in the parent follows.
+  void _borrow_leaf(Leaf* left, Leaf* right, Inner* parent, size_type l) {
+    if (left->count < right->count) {
+      left->keys[left->count] = std::move(right->keys[0]);
+      left->values[left->count] = std::move(right->values[0]);
+      ++ left->count;
+      _shift_left(right->keys, 1, right->count);
+      _shift_left(right->values, 1, right->count);
+      -- right->count;
+    }
+    else {
+      _shift_right(right->keys, 0, right->count);
+      _shift_right(right->values, 0, right->count);
+      -- left->count;
+      right->keys[0] = std::move(left->keys[left->count]);
+      right->values[0] = std::move(left->values[left->count]);
+      ++ right->count;
+    }
+    parent->keys[l] = right->keys[0];
+  }
+
+  // the same for inner nodes, where a key and a child
+  // rotate through the separator.
+  void _borrow_inner(Inner* left, Inner* right, Inner* parent, size_type l) {
+    if (left->count < right->count) {
+      left->keys[left->count] = std::move(parent->keys[l]);
+      left->children[left->count + 1] = right->children[0];
+      ++ left->count;
+      parent->keys[l] = std::move(right->keys[0]);
+      _shift_left(right->keys, 1, right->count);
+      _shift_left(right->children, 1, right->count + 1);
+      -- right->count;
+    }
+    else {
+      _shift_right(right->keys, 0, right->count);
+      _shift_right(right->children, 0, right->count + 1);
+      right->keys[0] = std::move(parent->keys[l]);
+      right->children[0] = left->children[left->count];
+      ++ right->count;
+      parent->keys[l] = std::move(left->keys[left->count - 1]);
+      -- left->count;
+    }
+  }
+
+  // move all of right into left, and delete right.
+  void _merge_leaves(Leaf* left, Leaf* right) {
+    for (size_type j=0; j<right->count; ++j) {
+      left->keys[left->count + j] = std::move(right->keys[j]);
+      left->values[left->count + j] = std::move(right->values[j]);
+    }
+    left->count += right->count;
+    left->next = right->next;
+    if (right->next != NULL) {
+      right->next->prev = left;
+    }
+    else {
+      last_m = left;
+    }
+    delete right;
+  }
+
+  // the separator k comes down between the two.
+  void _merge_inners(Inner* left, Inner* right, const Key& k) {
+    left->keys[left->count] = k;
+    for (size_type j=0; j<right->count; ++j) {
+      left->keys[left->count + 1 + j] = std::move(right->keys[j]);
+    }
+    for (size_type j=0; j<=right->count; ++j) {
+      left->children[left->count + 1 + j] = right->children[j];
+    }
+    left->count += right->count + 1;
+    delete right;
+  }
+
+  // copy the nodes of x, chaining the leaves in order.
+  void _copy_from(const Self& x) {
+    Leaf* last = NULL;
+    root_m = _copy_nodes(x.root_m, last);
+    last_m = last;
+    size_m = x.size_m;
+  }
+
+  // copy the subtree x. last is the latest copied leaf.
+  NodeBase* _copy_nodes(const NodeBase* x, Leaf*& last) {
+    if (x == NULL) {
+      return NULL;
+    }
+    if (x->is_leaf) {
+      Leaf* ret = new Leaf(*static_cast<const Leaf*>(x));
+      ret->prev = last;
+      ret->next = NULL;
+      if (last != NULL) {
+	last->next = ret;
+      }
+      else {
+	first_m = ret;
+      }
+      last = ret;
+      return ret;
+    }
+    const Inner* inner = static_cast<const Inner*>(x);
+    Inner* ret = new Inner;
+    ret->count = inner->count;
+    for (size_type j=0; j<inner->count; ++j) {
+      ret->keys[j] = inner->keys[j];
+    }
+    for (size_type j=0; j<=inner->count; ++j) {
+      ret->children[j] = _copy_nodes(inner->children[j], last);
+    }
+    return ret;
+  }
+
+  void _delete_nodes(NodeBase* x) {
+    if (x == NULL) {
+      return;
+    }
+    if (x->is_leaf) {
+      delete static_cast<Leaf*>(x);
+      return;
+    }
+    Inner* inner = static_cast<Inner*>(x);
+    for (size_type j=0; j<=inner->count; ++j) {
+      _delete_nodes(inner->children[j]);
+    }
+    delete inner;
+  }
+
+  // drop the nodes without deleting them.
+  void _forget() {
+    root_m = NULL;
+    first_m = last_m = NULL;
+    size_m = 0;
+  }
+
+  NodeBase* root_m;
+  // the ends of the leaf chain.
+  Leaf* first_m;
+  Leaf* last_m;
+  size_type size_m;
+};
+
+#endif // BPTREEMAP_HPP
@@ -1,7 +1,20 @@
 /**
- * a simple binary search tree.
- * no implementation of balancing.
+ * an ordered map kept as a red-black tree, so that
+ * insert, erase and find are O(log n) even when the
+ * keys come in sorted. nodes know their parent, so
+ * iterators walk the tree without a stack. each node
+ * also counts the nodes of its subtree, which gives
+ * rank and select in O(log n).
  */
+
+#ifndef BSTMAP_HPP
+#define BSTMAP_HPP
+
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+using namespace std;
+
 template <class Key, class T>
 class bstmap
 {
@@ -16,25 +29,34 @@ public:
   typedef int                difference_type;
   
 public:
+  enum color_t { red, black };
+
   /**
    * \class Node.
    * \brief Node of a bstmap. A Node stores a 
    * key value pair, and has three pointer to
    * its left and right child and its parent.
+   * New nodes are red, and alone in their subtree.
    */
   class Node {
   public:
-    Node(value_type my_pair, Node* my_parent, Node* my_left, Node* my_right):
-      value_m(my_pair), parent(my_parent), left_child(my_left), right_child(my_right) {}
+    Node(value_type my_pair, Node* my_parent, Node* my_left, Node* my_right,
+	 color_t my_color=red):
+      value_m(my_pair), parent(my_parent), left_child(my_left), right_child(my_right),
+      color(my_color), subtree_size(1) {}
     Node(const Node& x):
-      value_m(x.value_m), parent(x.parent), left_child(x.left_child), right_child(x.right_child) {}
+      value_m(x.value_m), parent(x.parent), left_child(x.left_child), right_child(x.right_child),
+      color(x.color), subtree_size(x.subtree_size) {}
     ~Node() {}
 
     value_type value_m;
     Node* parent;
     Node* left_child;
     Node* right_child;
-  }
+    color_t color;
+    // the number of nodes under and including this one.
+    size_type subtree_size;
+  };
 
 public:
   
@@ -42,9 +64,9 @@ public:
   class _iterator {
     // your iterator definition goes here
   public:
-    typedef std::input_iterator_tag iterator_category;
+    typedef std::bidirectional_iterator_tag iterator_category;
     typedef val_T value_type;
-    typedef difference_type difference_type;
+    typedef int   difference_type;
     typedef value_type* pointer;
     typedef value_type& reference;
 
@@ -85,12 +107,24 @@ public:
 
     // post ++, use sort of hack method,
     // pass a dummy int argument.
-    _iterator& operator++(int) {
+    _iterator operator++(int) {
       _iterator ret(*this);
       node_m = map_m->_successor(node_m);
       return ret;
     }
 
+    // going back from end() gives the last element.
+    _iterator& operator--() {
+      node_m = node_m ? map_m->_predecessor(node_m) : map_m->_right_most_child();
+      return *this;
+    }
+
+    _iterator operator--(int) {
+      _iterator ret(*this);
+      --(*this);
+      return ret;
+    }
+
   private:
     Base_T* map_m;
     Node* node_m;
@@ -112,10 +146,18 @@ public:
   bstmap(const Self& x) {
     size_m = x.size_m;
     // copy all nodes. keep the original structure.
-    root_m = x.root_m;
-    for (iterator it = begin(); it ! = end(); ++it) {
-      
-    }
+    root_m = _copy_nodes(x.root_m, NULL);
+  }
+
+  // move constructor, x is left empty.
+  bstmap(Self&& x) noexcept: root_m(x.root_m), size_m(x.size_m) {
+    x.root_m = NULL;
+    x.size_m = 0;
+  }
+
+  // destructor.
+  ~bstmap() {
+    clear();
   }
 
   // overload assignment to do a deep copy
@@ -125,11 +167,28 @@ public:
       clear();
       size_m = x.size_m;
       // copy all nodes of x.
-      
+      root_m = _copy_nodes(x.root_m, NULL);
+    }
+    return *this;
+  }
+
+  // move assignment, x is left empty.
+  Self& operator=(Self&& x) noexcept {
+    if (this != &x) {
+      clear();
+      root_m = x.root_m;
+      size_m = x.size_m;
+      x.root_m = NULL;
+      x.size_m = 0;
     }
     return *this;
   }
 
+  void swap(Self& x) {
+    std::swap(root_m, x.root_m);
+    std::swap(size_m, x.size_m);
+  }
+
 
 
   // accessors:
@@ -157,44 +216,52 @@ public:
   // insert/erase
   pair<iterator,bool> insert(const value_type& x) {
     pair<Node*, bool> indicator = _find(x.first);
-    pair<iterator, bool> ret(iterator(this, NULL), false);
     // if the key already exist
     if (indicator.second) {
-      return ret;
+      return pair<iterator, bool>(iterator(this, indicator.first), false);
+    }
+    // the key's not found, hang it from the last
+    // node the search went through.
+    Node* parent = indicator.first;
+    Node* new_node = new Node(x, parent, NULL, NULL);
+    if (parent == NULL) {
+      // first time insert to an empty tree.
+      root_m = new_node;
+    }
+    else if (x.first < (parent->value_m).first) {
+      parent->left_child = new_node;
     }
-    // the key's not found, can insert.
     else {
-      ++ size_m;
-      if (indicator.first == NULL) {
-	// first time insert to an empty tree.
-	root_m = new Node(x, NULL, NULL, NULL);
-	ret.first = iterator(this, root_m);
-	ret.second = true;
-	return ret;
-      }
-      else {
-	if (x.first > ((indicator.first)->value_m).first) {
-	  (indicator.first)->right_child = new Node(x, indicator.first, NULL, NULL);
-	  ret.first = iterator(this, indicator.first);
-	  ret.second = true;
-	  return ret;
-	}
-	else {
-	  (indicator.first)->left_child = new Node(x, indicator.first, NULL, NULL);
-	  ret.first = iterator(this, indicator.first);
-	  ret.second = true;
-	  return ret;
-	}
-      }
+      parent->right_child = new_node;
+    }
+    ++ size_m;
+    for (Node* p=parent; p!=NULL; p=p->parent) {
+      ++ p->subtree_size;
     }
+    _insert_fixup(new_node);
+    return pair<iterator, bool>(iterator(this, new_node), true);
   }
   
-  void erase(iterator pos) {}
-  size_type erase(const Key& x) {}
+  void erase(iterator pos) {
+    if (pos.node_m != NULL) {
+      _erase_node(pos.node_m);
+    }
+  }
+
+  size_type erase(const Key& x) {
+    pair<Node*, bool> ret = _find(x);
+    if (!ret.second) {
+      // the key's not found.
+      return 0;
+    }
+    _erase_node(ret.first);
+    return 1;
+  }
   
   void clear() {
     _recursively_delete_nodes(root_m);
     root_m = NULL;
+    size_m = 0;
   }
 
   // map operations:
@@ -231,10 +298,81 @@ public:
 
   T& operator[](const Key& k) {
     // find the key.
-    iterator it = find(x);
+    pair<Node*, bool> ret = _find(k);
     // if key's found, return it. 
     // otherwise, insert it.
-    return x->second;
+    if (ret.second) {
+      return ret.first->value_m.second;
+    }
+    return insert(value_type(k, T())).first->second;
+  }
+
+  // ordered operations. a scan from lower_bound
+  // over k entries costs O(log n + k).
+  iterator lower_bound(const Key& x) {
+    return iterator(this, _lower_bound(x));
+  }
+  const_iterator lower_bound(const Key& x) const {
+    return const_iterator(this, _lower_bound(x));
+  }
+  iterator upper_bound(const Key& x) {
+    return iterator(this, _upper_bound(x));
+  }
+  const_iterator upper_bound(const Key& x) const {
+    return const_iterator(this, _upper_bound(x));
+  }
+  pair<iterator, iterator> equal_range(const Key& x) {
+    return pair<iterator, iterator>(lower_bound(x), upper_bound(x));
+  }
+  pair<const_iterator, const_iterator> equal_range(const Key& x) const {
+    return pair<const_iterator, const_iterator>(lower_bound(x), upper_bound(x));
+  }
+
+  // the number of keys less than x.
+  size_type rank(const Key& x) const {
+    size_type ret = 0;
+    Node* curr = root_m;
+    while (curr != NULL) {
+      if ((curr->value_m).first < x) {
+	ret += _size(curr->left_child) + 1;
+	curr = curr->right_child;
+      }
+      else {
+	curr = curr->left_child;
+      }
+    }
+    return ret;
+  }
+
+  // the entry with k keys before it, or end().
+  iterator select(size_type k) {
+    return iterator(this, _select(k));
+  }
+  const_iterator select(size_type k) const {
+    return const_iterator(this, _select(k));
+  }
+
+  /**
+   * \brief replace the entries with those of [first, last),
+   * whose keys must be strictly increasing, in O(n). the
+   * tree is built balanced, without any comparisons.
+   */
+  template <class ForwardIt>
+  void assign_sorted(ForwardIt first, ForwardIt last) {
+    size_type n = 0;
+    for (ForwardIt it=first; it!=last; ++it, ++n) {
+      ForwardIt next = it;
+      if (++next != last && !(it->first < next->first)) {
+	throw runtime_error("bstmap::assign_sorted: keys are not strictly increasing");
+      }
+    }
+    clear();
+    // the bottom level, when it's not full, is red,
+    // so that every path has as many black nodes.
+    int bottom = 0;
+    while ((2u << bottom) <= n) ++bottom;
+    root_m = _build_sorted(first, n, NULL, 0, bottom);
+    size_m = n;
   }
 
 private:
@@ -251,20 +389,20 @@ private:
     Node* curr = root_m;
     while (curr != NULL) {
       curr_parent = curr;
-      if (x == (curr->value_m).first) {
-	// return ret with the current node.
-	ret.first = curr;
-	ret.second = true;
-	return ret;
-      }
-      else if (x < (curr->value_m).first) {
+      if (x < (curr->value_m).first) {
 	// if x is less than curr key, go to its left child.
 	curr = curr->left_child;
       }
-      else if (x > (curr->value_m).first) {
+      else if ((curr->value_m).first < x) {
 	// else go to the right child.
 	curr = curr->right_child;
       }
+      else {
+	// return ret with the current node.
+	ret.first = curr;
+	ret.second = true;
+	return ret;
+      }
     }
     // return ret indicates key not found.
     ret.first = curr_parent;
@@ -276,18 +414,12 @@ private:
    * \return the successor node of ele, if 
    * ele has no successor, return NULL.
    */
-`  Node* _successor(Node* ele) const {
+  Node* _successor(Node* ele) const {
     // if ele has a right subtree, then
     // the successor is the left most element
     // of the subtree.
     if (ele->right_child != NULL) {
-      Node* curr = ele->right_child;
-      Node* ret;
-      while (curr != NULL) {
-	ret = curr;
-	curr = curr->left_child;
-      }
-      return ret;
+      return _min_node(ele->right_child);
     }
     // else keep moving up until finding
     // a parent which branches from the left.
@@ -302,16 +434,379 @@ private:
     }
   }
 
-  Node* _left_most_child() {
+  /**
+   * \brief find the predecessor of node ele.
+   * \return the predecessor node of ele, if
+   * ele has no predecessor, return NULL.
+   */
+  Node* _predecessor(Node* ele) const {
+    if (ele->left_child != NULL) {
+      return _max_node(ele->left_child);
+    }
+    Node* ret = ele->parent;
+    Node* curr = ele;
+    while ((ret != NULL) && (ret->right_child != curr)) {
+      curr = ret;
+      ret = ret->parent;
+    }
+    return ret;
+  }
+
+  Node* _left_most_child() const {
+    return root_m ? _min_node(root_m) : NULL;
+  }
+
+  Node* _right_most_child() const {
+    return root_m ? _max_node(root_m) : NULL;
+  }
+
+  // the left most and right most nodes of the
+  // subtree x, which is not empty.
+  static Node* _min_node(Node* x) {
+    while (x->left_child != NULL) {
+      x = x->left_child;
+    }
+    return x;
+  }
+
+  static Node* _max_node(Node* x) {
+    while (x->right_child != NULL) {
+      x = x->right_child;
+    }
+    return x;
+  }
+
+  // empty subtrees count as black.
+  static bool _is_black(const Node* x) {
+    return x == NULL || x->color == black;
+  }
+
+  // replace the child link to x with y.
+  void _replace_child(Node* x, Node* y) {
+    if (x->parent == NULL) {
+      root_m = y;
+    }
+    else if (x == x->parent->left_child) {
+      x->parent->left_child = y;
+    }
+    else {
+      x->parent->right_child = y;
+    }
+  }
+
+  static size_type _size(const Node* x) {
+    return x == NULL ? 0 : x->subtree_size;
+  }
+
+  // recount x from its children.
+  static void _update_size(Node* x) {
+    x->subtree_size = _size(x->left_child) + _size(x->right_child) + 1;
+  }
+
+  /**
+   * \brief rotate x down to the left, its right
+   * child takes its place, and its subtree.
+   */
+  void _rotate_left(Node* x) {
+    Node* y = x->right_child;
+    x->right_child = y->left_child;
+    if (y->left_child != NULL) {
+      y->left_child->parent = x;
+    }
+    y->parent = x->parent;
+    _replace_child(x, y);
+    y->left_child = x;
+    x->parent = y;
+    y->subtree_size = x->subtree_size;
+    _update_size(x);
+  }
+
+  /**
+   * \brief rotate x down to the right, its left
+   * child takes its place, and its subtree.
+   */
+  void _rotate_right(Node* x) {
+    Node* y = x->left_child;
+    x->left_child = y->right_child;
+    if (y->right_child != NULL) {
+      y->right_child->parent = x;
+    }
+    y->parent = x->parent;
+    _replace_child(x, y);
+    y->right_child = x;
+    x->parent = y;
+    y->subtree_size = x->subtree_size;
+    _update_size(x);
+  }
+
+  /**
+   * \brief restore the red-black properties after
+   * the red node x was inserted: no red node has
+   * a red child, and the root is black.
+   */
+  void _insert_fixup(Node* x) {
+    while (x->parent != NULL && x->parent->color == red) {
+      // a red parent is never the root,
+      // so the grandparent exists.
+      Node* grandparent = x->parent->parent;
+      if (x->parent == grandparent->left_child) {
+	Node* uncle = grandparent->right_child;
+	if (!_is_black(uncle)) {
+	  // push the grandparent's blackness down,
+	  // and go on from the grandparent.
+	  x->parent->color = black;
+	  uncle->color = black;
+	  grandparent->color = red;
+	  x = grandparent;
+	}
+	else {
+	  if (x == x->parent->right_child) {
+	    x = x->parent;
+	    _rotate_left(x);
+	  }
+	  x->parent->color = black;
+	  grandparent->color = red;
+	  _rotate_right(grandparent);
+	}
+      }
+      else {
+	Node* uncle = grandparent->left_child;
+	if (!_is_black(uncle)) {
+	  x->parent->color = black;
+	  uncle->color = black;
+	  grandparent->color = red;
+	  x = grandparent;
+	}
+	else {
+	  if (x == x->parent->left_child) {
+	    x = x->parent;
+	    _rotate_right(x);
+	  }
+	  x->parent->color = black;
+	  grandparent->color = red;
+	  _rotate_left(grandparent);
+	}
+      }
+    }
+    root_m->color = black;
+  }
+
+  /**
+   * \brief unlink the node z, rebalance and delete it.
+   * a node with two children is replaced by its
+   * successor, which has no left child.
+   */
+  void _erase_node(Node* z) {
+    // x takes the place of the node that leaves
+    // the tree, and may be NULL, so its parent
+    // is kept as well.
+    Node* x;
+    Node* x_parent;
+    color_t removed_color = z->color;
+    // the subtrees above the node that leaves
+    // its place lose one node.
+    Node* removed = z;
+    if (z->left_child != NULL && z->right_child != NULL) {
+      removed = _min_node(z->right_child);
+    }
+    for (Node* p=removed->parent; p!=NULL; p=p->parent) {
+      -- p->subtree_size;
+    }
+    if (z->left_child == NULL || z->right_child == NULL) {
+      x = z->left_child ? z->left_child : z->right_child;
+      x_parent = z->parent;
+      _replace_child(z, x);
+      if (x != NULL) {
+	x->parent = x_parent;
+      }
+    }
+    else {
+      Node* y = removed;
+      removed_color = y->color;
+      x = y->right_child;
+      if (y->parent == z) {
+	x_parent = y;
+      }
+      else {
+	x_parent = y->parent;
+	x_parent->left_child = x;
+	if (x != NULL) {
+	  x->parent = x_parent;
+	}
+	y->right_child = z->right_child;
+	y->right_child->parent = y;
+      }
+      _replace_child(z, y);
+      y->parent = z->parent;
+      y->left_child = z->left_child;
+      y->left_child->parent = y;
+      y->color = z->color;
+      y->subtree_size = z->subtree_size;
+    }
+    delete z;
+    -- size_m;
+    if (removed_color == black) {
+      _erase_fixup(x, x_parent);
+    }
+  }
+
+  /**
+   * \brief restore the red-black properties after a
+   * black node was taken out above x, whose paths
+   * are now one black node short.
+   */
+  void _erase_fixup(Node* x, Node* x_parent) {
+    while (x != root_m && _is_black(x)) {
+      // x's side is short of a black node, so
+      // the sibling w's side can't be empty.
+      if (x == x_parent->left_child) {
+	Node* w = x_parent->right_child;
+	if (w->color == red) {
+	  w->color = black;
+	  x_parent->color = red;
+	  _rotate_left(x_parent);
+	  w = x_parent->right_child;
+	}
+	if (_is_black(w->left_child) && _is_black(w->right_child)) {
+	  // make w's side short too, and go up.
+	  w->color = red;
+	  x = x_parent;
+	  x_parent = x->parent;
+	}
+	else {
+	  if (_is_black(w->right_child)) {
+	    w->left_child->color = black;
+	    w->color = red;
+	    _rotate_right(w);
+	    w = x_parent->right_child;
+	  }
+	  w->color = x_parent->color;
+	  x_parent->color = black;
+	  w->right_child->color = black;
+	  _rotate_left(x_parent);
+	  x = root_m;
+	}
+      }
+      else {
+	Node* w = x_parent->left_child;
+	if (w->color == red) {
+	  w->color = black;
+	  x_parent->color = red;
+	  _rotate_right(x_parent);
+	  w = x_parent->left_child;
+	}
+	if (_is_black(w->left_child) && _is_black(w->right_child)) {
+	  w->color = red;
+	  x = x_parent;
+	  x_parent = x->parent;
+	}
+	else {
+	  if (_is_black(w->left_child)) {
+	    w->right_child->color = black;
+	    w->color = red;
+	    _rotate_left(w);
+	    w = x_parent->left_child;
+	  }
+	  w->color = x_parent->color;
+	  x_parent->color = black;
+	  w->left_child->color = black;
+	  _rotate_right(x_parent);
+	  x = root_m;
+	}
+      }
+    }
+    if (x != NULL) {
+      x->color = black;
+    }
+  }
+
+  // copy the subtree x, the copy hangs from parent.
+  Node* _copy_nodes(const Node* x, Node* parent) {
+    if (x == NULL) {
+      return NULL;
+    }
+    Node* ret = new Node(x->value_m, parent, NULL, NULL, x->color);
+    ret->subtree_size = x->subtree_size;
+    ret->left_child = _copy_nodes(x->left_child, ret);
+    ret->right_child = _copy_nodes(x->right_child, ret);
+    return ret;
+  }
+
+  // the first node whose key is not less than x, or NULL.
+  Node* _lower_bound(const Key& x) const {
+    Node* ret = NULL;
+    Node* curr = root_m;
+    while (curr != NULL) {
+      if ((curr->value_m).first < x) {
+	curr = curr->right_child;
+      }
+      else {
+	ret = curr;
+	curr = curr->left_child;
+      }
+    }
+    return ret;
+  }
+
+  // the first node whose key is greater than x, or NULL.
+  Node* _upper_bound(const Key& x) const {
     Node* ret = NULL;
     Node* curr = root_m;
     while (curr != NULL) {
-      ret = curr;
-      curr = curr->left;
+      if (x < (curr->value_m).first) {
+	ret = curr;
+	curr = curr->left_child;
+      }
+      else {
+	curr = curr->right_child;
+      }
     }
     return ret;
   }
 
+  // the node with k nodes before it, or NULL.
+  Node* _select(size_type k) const {
+    Node* curr = root_m;
+    while (curr != NULL) {
+      size_type left = _size(curr->left_child);
+      if (k < left) {
+	curr = curr->left_child;
+      }
+      else if (k == left) {
+	return curr;
+      }
+      else {
+	k -= left + 1;
+	curr = curr->right_child;
+      }
+    }
+    return NULL;
+  }
+
+  /**
+   * \brief build a balanced subtree of the next n entries
+   * from it, hanging from parent at the given depth. nodes
+   * on the bottom level are red, all others black.
+   */
+  template <class ForwardIt>
+  Node* _build_sorted(ForwardIt& it, size_type n, Node* parent, int depth, int bottom) {
+    if (n == 0) {
+      return NULL;
+    }
+    size_type left = n / 2;
+    color_t color = depth == bottom && depth > 0 ? red : black;
+    // the entries before this one go to the left.
+    Node* left_tree = _build_sorted(it, left, NULL, depth + 1, bottom);
+    Node* ret = new Node(*it, parent, left_tree, NULL, color);
+    if (left_tree != NULL) {
+      left_tree->parent = ret;
+    }
+    ++it;
+    ret->right_child = _build_sorted(it, n - left - 1, ret, depth + 1, bottom);
+    ret->subtree_size = n;
+    return ret;
+  }
+
   void _recursively_delete_nodes(Node* x) {
     if (x != NULL) {
       _recursively_delete_nodes(x->left_child);
@@ -323,3 +818,5 @@ private:
   Node* root_m;
   size_type size_m;
 };
+
+#endif // BSTMAP_HPP
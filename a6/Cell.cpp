@@ -5,7 +5,11 @@
  * It supports the cons list ADT interface specified in cons.hpp.
  */
 
+#include <charconv>
+#include <cctype>
+#include <algorithm>
 #include "Cell.hpp"
+#include "memo.hpp"
 
 using namespace std;
 
@@ -102,8 +106,70 @@ Cell* sub(T subtractor, const Cell* minuend_cell) {
   }
 }
 //////////////////////////////////////////////////
+/////////////////Number Formats///////////////////
+//////////////////////////////////////////////////
+/// the longest formatted int or double, with room
+/// for the padding of format_double.
+const int NUMBER_BUFFER_SIZE = 32;
+
+/// write i into buf as the stream << would.
+/// return the number of characters written.
+static int format_int(char* buf, int i) {
+  return to_chars(buf, buf + NUMBER_BUFFER_SIZE, i).ptr - buf;
+}
+
+/// write d into buf as the stream << would with
+/// setprecision(6) and showpoint, or, if built with
+/// -DSHORTEST_DOUBLES, in the fewest digits that
+/// read back as d.
+/// return the number of characters written.
+static int format_double(char* buf, double d) {
+#ifdef SHORTEST_DOUBLES
+  char* end = to_chars(buf, buf + NUMBER_BUFFER_SIZE, d).ptr;
+  // digits alone would read back as an int.
+  if (strspn(buf, "-0123456789") == static_cast<size_t>(end - buf)) {
+    *end++ = '.';
+    *end++ = '0';
+  }
+  return end - buf;
+#else
+  char* end = to_chars(buf, buf + NUMBER_BUFFER_SIZE, d, chars_format::general, 6).ptr;
+  // inf and nan have nothing to pad.
+  if (!isdigit(end[-1])) return end - buf;
+  // to_chars drops the trailing zeros that showpoint keeps, so
+  // pad the mantissa back to 6 significant digits and a point.
+  char* exponent = find(buf, end, 'e');
+  bool point = false;
+  int digits = 0;
+  for (const char* p = buf; p != exponent; ++p) {
+    if (*p == '.') {
+      point = true;
+    }
+    else if (isdigit(*p) && (digits || *p != '0')) {
+      ++digits;
+    }
+  }
+  // zero is printed with one significant digit.
+  if (!digits) digits = 1;
+  int padding = 6 - digits + (point ? 0 : 1);
+  memmove(exponent + padding, exponent, end - exponent);
+  char* p = exponent;
+  if (!point) *p++ = '.';
+  fill(p, exponent + padding, '0');
+  return end - buf + padding;
+#endif
+}
+//////////////////////////////////////////////////
 /////////////////Class Cell///////////////////////
 //////////////////////////////////////////////////
+int Cell::print_length = 0;
+int Cell::print_depth = 0;
+
+void Cell::set_print_limits(int length, int depth) {
+  print_length = length;
+  print_depth = depth;
+}
+
 bool Cell::is_int() const {
   return false;
 }
@@ -144,6 +210,10 @@ string Cell::get_symbol() const {
   throw runtime_error("calling get_symbol() on a non SymbolCell.");
 }
 
+const char* Cell::get_symbol_name() const {
+  throw runtime_error("calling get_symbol_name() on a non SymbolCell.");
+}
+
 Cell* Cell::get_car() const {
   throw runtime_error("calling car on a non-list type: " + to_str());
 }
@@ -160,6 +230,14 @@ Cell* Cell::get_body() const {
   throw runtime_error("calling get_body() on a non ProcedureCell.");
 }
 
+MemoTable* Cell::get_memo() const {
+  throw runtime_error("calling get_memo() on a non ProcedureCell.");
+}
+
+ProcedureCode* Cell::get_code() const {
+  throw runtime_error("calling get_code() on a non ProcedureCell.");
+}
+
 int Cell::len() const {
   throw runtime_error("attempt length on a non-list type.");
 }
@@ -197,7 +275,7 @@ bool Cell::less_than(const Cell* c) const {
   throw runtime_error("operand of < cannot be: " + to_str());
 }
 
-Cell* Cell::call(Cell* c) const {
+Cell* Cell::call(Cell** args, int n) const {
   throw runtime_error("cannot apply non primitive func as primitive.");
 }
 //////////////////////////////////////////////////
@@ -207,6 +285,10 @@ string NilCell::to_str() const {
   return string("()");
 }
 
+void NilCell::print(ostream& os) const {
+  os.write("()", 2);
+}
+
 bool NilCell::is_nil() const {
   return true;
 }
@@ -233,9 +315,13 @@ Cell* const nil = new NilCell();
 IntCell::IntCell(int i): int_m(i) {}
 
 string IntCell::to_str() const {
-  stringstream ss;
-  ss << int_m;
-  return ss.str();
+  char buf[NUMBER_BUFFER_SIZE];
+  return string(buf, format_int(buf, int_m));
+}
+
+void IntCell::print(ostream& os) const {
+  char buf[NUMBER_BUFFER_SIZE];
+  os.write(buf, format_int(buf, int_m));
 }
 
 bool IntCell::is_int() const {
@@ -300,9 +386,13 @@ bool DoubleCell::is_double() const {
 }
 
 string DoubleCell::to_str() const {
-  stringstream ss;
-  ss << setprecision(6) << showpoint << double_m;
-  return ss.str();
+  char buf[NUMBER_BUFFER_SIZE];
+  return string(buf, format_double(buf, double_m));
+}
+
+void DoubleCell::print(ostream& os) const {
+  char buf[NUMBER_BUFFER_SIZE];
+  os.write(buf, format_double(buf, double_m));
 }
 
 Cell* DoubleCell::copy() const {
@@ -366,6 +456,13 @@ SymbolCell::SymbolCell(const char* const symbol) {
   symbol_m = cpy_str;
 }
 
+SymbolCell::SymbolCell(const char* const symbol, size_t length) {
+  char* cpy_str = new char[length + 1];
+  memcpy(cpy_str, symbol, length);
+  cpy_str[length] = '\0';
+  symbol_m = cpy_str;
+}
+
 SymbolCell::~SymbolCell() {
   delete[] symbol_m;
 }
@@ -378,10 +475,16 @@ string SymbolCell::get_symbol() const {
   return symbol_m;
 }
 
+const char* SymbolCell::get_symbol_name() const {
+  return symbol_m;
+}
+
 string SymbolCell::to_str() const {
-  stringstream ss;
-  ss << symbol_m;
-  return ss.str();
+  return string(symbol_m);
+}
+
+void SymbolCell::print(ostream& os) const {
+  os << symbol_m;
 }
 
 Cell* SymbolCell::copy() const {
@@ -394,11 +497,45 @@ bool SymbolCell::truth() const {
 //////////////////////////////////////////////////
 ////////////////Class ConsCell////////////////////
 //////////////////////////////////////////////////
-ConsCell::ConsCell(Cell* const my_car, Cell* const my_cdr): car(my_car), cdr(my_cdr) {}
+void (*ConsCell::delete_hook)(const Cell*) = NULL;
+
+ConsCell::ConsCell(Cell* const my_car, Cell* const my_cdr): 
+  car(my_car), cdr(my_cdr) {}
 
 ConsCell::~ConsCell() {
-  if (car != nil) delete car;
-  if (cdr != nil) delete cdr;
+  destroy(car);
+  destroy(cdr);
+  if (delete_hook != NULL) delete_hook(this);
+}
+
+void ConsCell::set_delete_hook(void (*hook)(const Cell* c)) {
+  delete_hook = hook;
+}
+
+void ConsCell::destroy(Cell* c) {
+  // rotate nested lists in the car up into the cdr chain,
+  // then free the chain from the front. Each cell is
+  // deleted with nil car and cdr, so no destructor recurses.
+  while (c != nil) {
+    if (!c->is_cons()) {
+      delete c;
+      return;
+    }
+    ConsCell* cell = static_cast<ConsCell*>(c);
+    if (cell->car->is_cons()) {
+      ConsCell* nested = static_cast<ConsCell*>(cell->car);
+      cell->car = nested->cdr;
+      nested->cdr = cell;
+      c = nested;
+    }
+    else {
+      if (cell->car != nil) delete cell->car;
+      c = cell->cdr;
+      cell->car = nil;
+      cell->cdr = nil;
+      delete cell;
+    }
+  }
 }
 
 bool ConsCell::is_cons() const {
@@ -415,24 +552,63 @@ Cell* ConsCell::get_cdr() const {
 
 string ConsCell::to_str() const {
   stringstream ss;
-  ss << "(";
-  const Cell* car_cell = get_car();
-  const Cell* cdr_cell = get_cdr();
-  ss << car_cell->to_str();
-  while (cdr_cell->is_cons()) {
-    car_cell = cdr_cell->get_car();
-    ss << " ";
-    ss << car_cell->to_str();
-    cdr_cell = cdr_cell->get_cdr();
-  }
-  if (cdr_cell != nil) {
-    ss << " . ";
-    ss << cdr_cell->to_str();
-  }
-  ss << ")";
+  print(ss);
   return ss.str();
 }
 
+void ConsCell::print(ostream& os) const {
+  // an open list around the one being printed: the rest
+  // of it, and how many elements of it are printed.
+  struct OpenList {
+    const Cell* rest;
+    int count;
+  };
+  // kept between calls, so that once it has grown
+  // printing allocates nothing. Atoms never print a
+  // list, so this is never used by two calls at once.
+  static vector<OpenList> open;
+  open.clear();
+  const ConsCell* cell = this;
+  int count = 0;
+  os << '(';
+  while (true) {
+    const Cell* car_cell = cell->car;
+    if (car_cell->is_cons() && (!print_depth || static_cast<int>(open.size()) + 1 < print_depth)) {
+      OpenList around = {cell->cdr, count + 1};
+      open.push_back(around);
+      os << '(';
+      cell = static_cast<const ConsCell*>(car_cell);
+      count = 0;
+      continue;
+    }
+    if (car_cell->is_cons()) {
+      os << '#';
+    }
+    else {
+      car_cell->print(os);
+    }
+    ++count;
+    const Cell* cdr_cell = cell->cdr;
+    // close the lists that end here, until one goes on.
+    while (!cdr_cell->is_cons() || count == print_length) {
+      if (cdr_cell->is_cons()) {
+        os << " ...";
+      }
+      else if (cdr_cell != nil) {
+        os << " . ";
+        cdr_cell->print(os);
+      }
+      os << ')';
+      if (open.empty()) return;
+      cdr_cell = open.back().rest;
+      count = open.back().count;
+      open.pop_back();
+    }
+    os << ' ';
+    cell = static_cast<const ConsCell*>(cdr_cell);
+  }
+}
+
 int ConsCell::len() const {
   int l = 0;
   const Cell* cdr_cell = get_cdr();
@@ -448,11 +624,31 @@ int ConsCell::len() const {
 }
 
 Cell* ConsCell::copy() const {
-  Cell* copy_car = car;
-  Cell* copy_cdr = cdr;
-  if (car != nil) copy_car = car->copy();
-  if (cdr != nil) copy_cdr = cdr->copy();
-  return new ConsCell(copy_car, copy_cdr);
+  // copy along each cdr chain in a loop, and keep the nested
+  // lists in the car with the slot their copy goes to.
+  vector<pair<const Cell*, Cell**> > pending;
+  Cell* ret = nil;
+  pending.push_back(make_pair(static_cast<const Cell*>(this), &ret));
+  while (!pending.empty()) {
+    const Cell* from = pending.back().first;
+    Cell** to = pending.back().second;
+    pending.pop_back();
+    while (from->is_cons()) {
+      const ConsCell* cell = static_cast<const ConsCell*>(from);
+      ConsCell* cell_copy = new ConsCell(nil, nil);
+      *to = cell_copy;
+      if (cell->car->is_cons()) {
+        pending.push_back(make_pair(static_cast<const Cell*>(cell->car), &cell_copy->car));
+      }
+      else if (cell->car != nil) {
+        cell_copy->car = cell->car->copy();
+      }
+      from = cell->cdr;
+      to = &cell_copy->cdr;
+    }
+    if (from != nil) *to = from->copy();
+  }
+  return ret;
 }
 
 bool ConsCell::truth() const {
@@ -461,24 +657,53 @@ bool ConsCell::truth() const {
 //////////////////////////////////////////////////
 /////////////Class ProcedureCell//////////////////
 //////////////////////////////////////////////////
-ProcedureCell::ProcedureCell(Cell* my_formals, Cell* my_body):
-  formals(my_formals), body(my_body) {}
+ProcedureCode::ProcedureCode(Cell* my_formals, Cell* my_body):
+  formals(my_formals), body(my_body), refs(1) {}
 
-ProcedureCell::~ProcedureCell() {
+ProcedureCode::~ProcedureCode() {
   if (formals != nil) delete formals;
   if (body != nil) delete body;
 }
 
+ProcedureCode* ProcedureCode::retain() {
+  ++refs;
+  return this;
+}
+
+void ProcedureCode::release() {
+  --refs;
+  if (refs == 0) delete this;
+}
+
+ProcedureCell::ProcedureCell(Cell* my_formals, Cell* my_body, MemoTable* my_memo):
+  code(new ProcedureCode(my_formals, my_body)), memo(my_memo) {}
+
+ProcedureCell::ProcedureCell(ProcedureCode* my_code, MemoTable* my_memo):
+  code(my_code), memo(my_memo) {}
+
+ProcedureCell::~ProcedureCell() {
+  code->release();
+  if (memo != NULL) memo->release();
+}
+
 bool ProcedureCell::is_procedure() const {
   return true;
 }
 
 Cell* ProcedureCell::get_formals() const {
-  return formals;
+  return code->formals;
 }
 
 Cell* ProcedureCell::get_body() const {
-  return body;
+  return code->body;
+}
+
+MemoTable* ProcedureCell::get_memo() const {
+  return memo;
+}
+
+ProcedureCode* ProcedureCell::get_code() const {
+  return code;
 }
 
 string ProcedureCell::to_str() const {
@@ -486,11 +711,11 @@ string ProcedureCell::to_str() const {
 }
 
 Cell* ProcedureCell::copy() const {
-  Cell* copy_formals = formals;
-  Cell* copy_body = body;
-  if (formals != nil) copy_formals = formals->copy();
-  if (body != nil) copy_body = body->copy();
-  return new ProcedureCell(copy_formals, copy_body);  
+  // formals and body are never modified, so
+  // copies share them instead of copying them.
+  MemoTable* copy_memo = memo;
+  if (memo != NULL) copy_memo = memo->retain();
+  return new ProcedureCell(code->retain(), copy_memo);
 }
 
 bool ProcedureCell::truth() const {
@@ -499,8 +724,8 @@ bool ProcedureCell::truth() const {
 //////////////////////////////////////////////////
 /////////////Class PrimitiveCell//////////////////
 //////////////////////////////////////////////////
-PrimitiveCell::PrimitiveCell(Cell *(*f)(Cell*)):
-  primitive_func(f) {}
+PrimitiveCell::PrimitiveCell(const char* my_name, PrimitiveFunc f, int my_min, int my_max):
+  name(my_name), primitive_func(f), min_args(my_min), max_args(my_max) {}
 
 bool PrimitiveCell::is_primitive() const {
   return true;
@@ -511,13 +736,30 @@ string PrimitiveCell::to_str() const {
 }
 
 Cell* PrimitiveCell::copy() const {
-  return new PrimitiveCell(primitive_func);
+  return new PrimitiveCell(name, primitive_func, min_args, max_args);
 }
 
 bool PrimitiveCell::truth() const {
   return true;
 }
 
-Cell* PrimitiveCell::call(Cell* c) const {
-  return primitive_func(c);
+Cell* PrimitiveCell::call(Cell** args, int n) const {
+  // the arity is checked here once, so that the primitive
+  // procedures can index args directly.
+  if (n < min_args || (max_args != NO_MAX_ARGS && n > max_args)) {
+    stringstream ss;
+    ss << "operator " << name << " expects ";
+    if (min_args == max_args) {
+      ss << "exactly " << min_args;
+    }
+    else if (max_args == NO_MAX_ARGS) {
+      ss << "at least " << min_args;
+    }
+    else {
+      ss << min_args << " to " << max_args;
+    }
+    ss << " operand(s), but " << n << " given.";
+    throw runtime_error(ss.str());
+  }
+  return primitive_func(args, n);
 }
@@ -29,10 +29,28 @@
 #include <sstream>
 #include <string>
 #include <stack>
+#include <vector>
 
 #include <iomanip>
 #include <stdexcept>
 #include <map>
+#include <cstring>
+
+class Cell;
+class MemoTable;
+class ProcedureCode;
+
+/**
+ * \brief Signature of a primitive procedure. The evaluated arguments
+ * are passed in as an array args of n cells.
+ */
+typedef Cell* (*PrimitiveFunc)(Cell** args, int n);
+
+/**
+ * \brief The maximum number of arguments of a primitive procedure
+ * that takes any number of them.
+ */
+const int NO_MAX_ARGS = -1;
 
 /**
  * \class Cell
@@ -94,11 +112,19 @@ public:
   virtual bool is_primitive() const;
 
   /**
-   * \brief Print the subtree rooted at this cell, in s-expression notation.
+   * \brief Print the subtree rooted at this cell, in s-expression notation,
+   * straight into os and within the print limits.
    * \param os The output stream to print to.
    */
   virtual void print(std::ostream& os = std::cout) const;
 
+  /**
+   * \brief Limit how much of a list is printed from now on. Lists
+   * print at most length elements and then "...", and lists nested
+   * deeper than depth print as "#". 0 means no limit.
+   */
+  static void set_print_limits(int length, int depth);
+
   /**
    * \brief Count elements in a subtree, rooted at this cell. (error if this is not a well-formed list).
    * \return Number of elements in the tree, zero if it is not a tree.
@@ -123,6 +149,12 @@ public:
    */
   virtual std::string get_symbol() const;
 
+  /**
+   * \brief Accessor without copying (error if this is not a SymbolCell).
+   * \return The symbol name stored in the cell.
+   */
+  virtual const char* get_symbol_name() const;
+
   /**
    * \brief Accessor (error if this is not a ConsCell).
    * \return First element in the cell.
@@ -149,6 +181,19 @@ public:
    */
   virtual Cell* get_body() const;
 
+  /**
+   * \brief Accessor (error if this is not a ProcedureCell).
+   * \return The result cache of the function of this cell,
+   * NULL if the function is not memoized.
+   */
+  virtual MemoTable* get_memo() const;
+
+  /**
+   * \brief Accessor (error if this is not a ProcedureCell).
+   * \return The formals and body shared by the copies of this cell.
+   */
+  virtual ProcedureCode* get_code() const;
+
   /**
    * \brief Convert this cell into a string that represents it.
    * \return A string in s-expression representing this cell.
@@ -219,10 +264,18 @@ public:
   virtual bool less_than(const Cell* c) const;
 
   /**
-   * \brief make a primitive function call. (error if this is not a PrimitiveCell).
-   * \return the function pointer to a primitive procedure stored in this cell.
+   * \brief make a primitive function call. (error if this is not a PrimitiveCell,
+   * or if n doesn't match the arity of the primitive procedure).
+   * \param args Array of the evaluated arguments.
+   * \param n Number of arguments in args.
+   * \return the result of calling the primitive procedure stored in this cell.
    */
-  virtual Cell* call(Cell* c) const;
+  virtual Cell* call(Cell** args, int n) const;
+
+protected:
+  // the print limits, 0 if there's none.
+  static int print_length;
+  static int print_depth;
 };
 
 /**
@@ -244,6 +297,8 @@ public:
 
   virtual std::string to_str() const;
 
+  virtual void print(std::ostream& os = std::cout) const;
+
   virtual bool is_int() const;
 
   virtual int get_int() const;
@@ -285,6 +340,8 @@ public:
 
   virtual std::string to_str() const;
 
+  virtual void print(std::ostream& os = std::cout) const;
+
   virtual bool is_double() const;
 
   virtual double get_double() const;
@@ -323,6 +380,12 @@ public:
    */
   SymbolCell(const char* const symbol);
 
+  /**
+   * \brief Constructor to make SymbolCell of the first length
+   * characters of symbol, which needn't be null terminated.
+   */
+  SymbolCell(const char* const symbol, size_t length);
+
   /**
    * \brief Destructor.
    */
@@ -330,10 +393,14 @@ public:
 
   virtual std::string get_symbol() const;
 
+  virtual const char* get_symbol_name() const;
+
   virtual bool is_symbol() const;
 
   virtual std::string to_str() const;
 
+  virtual void print(std::ostream& os = std::cout) const;
+
   virtual Cell* copy() const;
 
   virtual bool truth() const;
@@ -359,8 +426,16 @@ public:
    */
   virtual ~ConsCell();
 
+  /**
+   * \brief Call hook with each ConsCell about to be deleted from
+   * now on, so that tables keyed on cells can forget it. NULL for none.
+   */
+  static void set_delete_hook(void (*hook)(const Cell* c));
+
   virtual std::string to_str() const;
 
+  virtual void print(std::ostream& os = std::cout) const;
+
   virtual bool is_cons() const;
 
   virtual int len() const;
@@ -374,8 +449,17 @@ public:
   virtual bool truth() const;
 
 private:
+  /**
+   * \brief Delete c and every cell it holds, without recursion,
+   * so that lists of any length or depth can be freed.
+   */
+  static void destroy(Cell* c);
+
   Cell* car;
   Cell* cdr;
+
+  // called with each cell about to be deleted, NULL if there's none.
+  static void (*delete_hook)(const Cell* c);
 };
 
 /**
@@ -397,6 +481,8 @@ public:
 
   virtual std::string to_str() const;
 
+  virtual void print(std::ostream& os = std::cout) const;
+
   virtual bool is_nil() const;
 
   virtual int len() const;
@@ -407,6 +493,43 @@ public:
 
 };
 
+/**
+ * \class ProcedureCode
+ * \brief Formal parameters and body of a user defined function.
+ * Shared by all copies of the ProcedureCell made from it, and 
+ * deleted when the last of them releases it.
+ */
+class ProcedureCode {
+public:
+  /**
+   * \brief Constructor, takes over my_formals and my_body.
+   */
+  ProcedureCode(Cell* my_formals, Cell* my_body);
+
+  /**
+   * \brief Destructor.
+   */
+  ~ProcedureCode();
+
+  /**
+   * \brief Register one more ProcedureCell sharing this code.
+   * \return This code.
+   */
+  ProcedureCode* retain();
+
+  /**
+   * \brief Unregister a ProcedureCell sharing this code,
+   * delete the code if it was the last one.
+   */
+  void release();
+
+  Cell* formals;
+  Cell* body;
+
+private:
+  int refs;
+};
+
 /**
  * \class ProcedureCell
  * \brief Class ProcedureCell to store a user defined function.
@@ -415,8 +538,16 @@ class ProcedureCell: public Cell {
 public:
   /**
    * \brief Constructor to make ProcedureCell.
+   * \param my_memo The result cache if the function is memoized,
+   * the cell takes over one reference to it.
+   */
+  ProcedureCell(Cell* my_formals, Cell* my_body, MemoTable* my_memo=NULL);
+
+  /**
+   * \brief Constructor to make ProcedureCell out of shared code.
+   * The cell takes over one reference to my_code and my_memo.
    */
-  ProcedureCell(Cell* my_formals, Cell* my_body);
+  ProcedureCell(ProcedureCode* my_code, MemoTable* my_memo=NULL);
   
   /**
    * \brief Destructor.
@@ -429,6 +560,10 @@ public:
 
   virtual Cell* get_body() const;
 
+  virtual MemoTable* get_memo() const;
+
+  virtual ProcedureCode* get_code() const;
+
   virtual std::string to_str() const;
 
   virtual Cell* copy() const;
@@ -436,8 +571,8 @@ public:
   virtual bool truth() const;
   
 private:
-  Cell* formals;
-  Cell* body;
+  ProcedureCode* code;
+  MemoTable* memo;
 };
 
 /**
@@ -449,8 +584,12 @@ class PrimitiveCell: public Cell {
 public:
   /**
    * \brief Constructor to make PrimitiveCell.
+   * \param my_name Name of the operator, used in error messages.
+   * \param f The primitive procedure.
+   * \param my_min The minimum number of arguments.
+   * \param my_max The maximum number of arguments, NO_MAX_ARGS if there's no limit.
    */
-  PrimitiveCell(Cell *(*f)(Cell*));
+  PrimitiveCell(const char* my_name, PrimitiveFunc f, int my_min, int my_max);
   
   /**
    * \brief Destructor.
@@ -465,10 +604,13 @@ public:
 
   virtual bool truth() const;
 
-  virtual Cell* call(Cell* c) const;
+  virtual Cell* call(Cell** args, int n) const;
   
 private:
-  Cell *(*primitive_func)(Cell*);
+  const char* name;
+  PrimitiveFunc primitive_func;
+  int min_args;
+  int max_args;
 };
 
 extern Cell* const nil;
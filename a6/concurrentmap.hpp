@@ -0,0 +1,345 @@
+/**
+ * \file concurrentmap.hpp
+ *
+ * A hash table map that many threads can use at once, for a global frame
+ * shared by several evaluators. Like hashtablemap it chains the entries
+ * of each bucket, but the links and values are atomic pointers, so finds
+ * walk the chains without taking any lock. Writers lock one of a fixed
+ * set of stripes, each guarding every stripe_count-th bucket. Erased
+ * nodes and replaced values are freed only once every thread that could
+ * still be reading them has left the map, which is tracked with epochs.
+ *
+ * Finds hand back a copy of the value instead of an iterator, since an
+ * entry may be erased as soon as the lock-free walk has left it.
+ */
+
+#ifndef CONCURRENTMAP_HPP
+#define CONCURRENTMAP_HPP
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "strhash.hpp"
+using namespace std;
+
+/**
+ * \class epoch_domain
+ * \brief Deferred freeing of memory that readers may still hold.
+ *
+ * A reader pins the current global epoch while it reads, and writers
+ * retire what they unlink together with the epoch it was unlinked in.
+ * The global epoch only advances when every pinned reader has seen the
+ * current one, so anything retired two epochs ago is unreachable.
+ */
+class epoch_domain {
+public:
+  // the number of threads that can be reading at the same time.
+  enum { max_readers = 128 };
+
+  epoch_domain(): epoch_m(1), retired_since_m(0) {
+    for (int i=0; i<max_readers; ++i) {
+      slots_m[i].epoch.store(0, memory_order_relaxed);
+    }
+  }
+
+  // free everything, no thread may be using the domain.
+  ~epoch_domain() {
+    for (size_t i=0; i<retired_m.size(); ++i) {
+      retired_m[i].free(retired_m[i].p);
+    }
+  }
+
+  /**
+   * \class guard
+   * \brief Keeps the epoch pinned for as long as it lives.
+   */
+  class guard {
+  public:
+    guard(epoch_domain& d): domain_m(d), slot_m(d._pin()) {}
+    ~guard() {
+      domain_m._unpin(slot_m);
+    }
+  private:
+    guard(const guard&);
+    guard& operator=(const guard&);
+    epoch_domain& domain_m;
+    int slot_m;
+  };
+
+  // free p with f once no reader can hold it any more.
+  void retire(void* p, void (*f)(void*)) {
+    lock_guard<mutex> lock(retired_lock_m);
+    retired r = {p, f, epoch_m.load(memory_order_seq_cst)};
+    retired_m.push_back(r);
+    // try to reclaim every so often, not on every retire.
+    if (++retired_since_m >= reclaim_period) {
+      retired_since_m = 0;
+      _try_advance();
+      _reclaim();
+    }
+  }
+
+private:
+  enum { reclaim_period = 64 };
+
+  struct retired {
+    void* p;
+    void (*free)(void*);
+    unsigned long epoch;
+  };
+
+  // a reader's pinned epoch, 0 when the slot is free.
+  // each on its own cache line, so readers don't
+  // slow each other down.
+  struct slot {
+    atomic<unsigned long> epoch;
+    char pad[64 - sizeof(atomic<unsigned long>)];
+  };
+
+  int _pin() {
+    // each thread starts looking at the slot it had last.
+    static thread_local int hint = 0;
+    for (int k=0; ; ++k) {
+      int i = (hint + k) % max_readers;
+      unsigned long free_slot = 0;
+      unsigned long e = epoch_m.load(memory_order_seq_cst);
+      if (slots_m[i].epoch.load(memory_order_relaxed) == 0 &&
+	  slots_m[i].epoch.compare_exchange_strong(free_slot, e, memory_order_seq_cst)) {
+	// the epoch may have moved on before the slot was
+	// taken, pin again until it holds the current one.
+	while (epoch_m.load(memory_order_seq_cst) != e) {
+	  e = epoch_m.load(memory_order_seq_cst);
+	  slots_m[i].epoch.store(e, memory_order_seq_cst);
+	}
+	hint = i;
+	return i;
+      }
+    }
+  }
+
+  void _unpin(int i) {
+    slots_m[i].epoch.store(0, memory_order_release);
+  }
+
+  // advance the epoch if no reader is pinned to an older one.
+  void _try_advance() {
+    unsigned long e = epoch_m.load(memory_order_seq_cst);
+    for (int i=0; i<max_readers; ++i) {
+      unsigned long pinned = slots_m[i].epoch.load(memory_order_seq_cst);
+      if (pinned != 0 && pinned != e) return;
+    }
+    epoch_m.compare_exchange_strong(e, e + 1, memory_order_seq_cst);
+  }
+
+  // free what was retired two or more epochs ago.
+  void _reclaim() {
+    unsigned long e = epoch_m.load(memory_order_seq_cst);
+    size_t kept = 0;
+    for (size_t i=0; i<retired_m.size(); ++i) {
+      if (retired_m[i].epoch + 2 <= e) {
+	retired_m[i].free(retired_m[i].p);
+      }
+      else {
+	retired_m[kept++] = retired_m[i];
+      }
+    }
+    retired_m.resize(kept);
+  }
+
+  atomic<unsigned long> epoch_m;
+  slot slots_m[max_readers];
+  mutex retired_lock_m;
+  vector<retired> retired_m;
+  int retired_since_m;
+};
+
+template <class Key, class T>
+class concurrentmap
+{
+  typedef concurrentmap<Key, T>     Self;
+
+public:
+  typedef Key                key_type;
+  typedef T                  data_type;
+  typedef T                  mapped_type;
+  typedef pair<const Key, T> value_type;
+  typedef unsigned int       size_type;
+
+private:
+  /**
+   * \class Node.
+   * \brief A node of a bucket's chain. The key never changes,
+   * the value is replaced as a whole by swapping the pointer.
+   */
+  struct Node {
+    Node(const Key& key, size_type hash, T* value, Node* next):
+      key_m(key), hash_m(hash), value_m(value), next_m(next) {}
+    ~Node() {
+      delete value_m.load(memory_order_relaxed);
+    }
+    const Key key_m;
+    // hash of the key, computed once on insertion.
+    const size_type hash_m;
+    atomic<T*> value_m;
+    atomic<Node*> next_m;
+  };
+
+public:
+  // create an empty map with m buckets.
+  concurrentmap(size_type m=503):
+    table_size(m), size_m(0)
+  {
+    table_m = new atomic<Node*>[table_size];
+    for (size_type i=0; i<table_size; ++i) {
+      table_m[i].store(NULL, memory_order_relaxed);
+    }
+  }
+
+  // destructor, no thread may be using the map.
+  ~concurrentmap() {
+    for (size_type i=0; i<table_size; ++i) {
+      Node* node = table_m[i].load(memory_order_relaxed);
+      while (node != NULL) {
+	Node* next = node->next_m.load(memory_order_relaxed);
+	delete node;
+	node = next;
+      }
+    }
+    delete [] table_m;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+  size_type size() const {
+    return size_m.load(memory_order_relaxed);
+  }
+  size_type bucket_count() const {
+    return table_size;
+  }
+
+  // insert x if its key is not in the map yet.
+  // return whether it was inserted.
+  bool insert(const value_type& x) {
+    size_type h = _hash_func(x.first);
+    lock_guard<mutex> lock(_stripe(h));
+    if (_find(x.first, h) != NULL) {
+      return false;
+    }
+    _push_front(x.first, h, new T(x.second));
+    return true;
+  }
+
+  // bind k to value, replacing the old value if there's one.
+  // return whether k was newly inserted.
+  bool insert_or_assign(const Key& k, const T& value) {
+    size_type h = _hash_func(k);
+    lock_guard<mutex> lock(_stripe(h));
+    Node* node = _find(k, h);
+    if (node == NULL) {
+      _push_front(k, h, new T(value));
+      return true;
+    }
+    // readers may still be copying the old value.
+    T* old = node->value_m.exchange(new T(value), memory_order_acq_rel);
+    domain_m.retire(old, &_free_value);
+    return false;
+  }
+
+  size_type erase(const Key& x) {
+    size_type h = _hash_func(x);
+    lock_guard<mutex> lock(_stripe(h));
+    atomic<Node*>* link = &table_m[h % table_size];
+    Node* node = link->load(memory_order_relaxed);
+    while (node != NULL && !(node->hash_m == h && node->key_m == x)) {
+      link = &node->next_m;
+      node = link->load(memory_order_relaxed);
+    }
+    if (node == NULL) {
+      // the key's not found.
+      return 0;
+    }
+    // readers on the node can still follow its next link.
+    link->store(node->next_m.load(memory_order_relaxed), memory_order_release);
+    size_m.fetch_sub(1, memory_order_relaxed);
+    domain_m.retire(node, &_free_node);
+    return 1;
+  }
+
+  // copy the value bound to x into value.
+  // return whether x was found. never blocks.
+  bool find(string_view x, T& value) const {
+    size_type h = _hash_func(x);
+    epoch_domain::guard pinned(domain_m);
+    Node* node = _find(x, h);
+    if (node == NULL) {
+      return false;
+    }
+    value = *node->value_m.load(memory_order_acquire);
+    return true;
+  }
+
+  size_type count(string_view x) const {
+    size_type h = _hash_func(x);
+    epoch_domain::guard pinned(domain_m);
+    return _find(x, h) != NULL ? 1 : 0;
+  }
+
+private:
+  // the number of locks shared out among the buckets.
+  enum { stripe_count = 64 };
+
+  concurrentmap(const Self&);
+  Self& operator=(const Self&);
+
+  // hash function. currently only work for string.
+  static size_type _hash_func(string_view key) {
+    return hash_string(key.data(), key.size());
+  }
+
+  mutex& _stripe(size_type h) {
+    return stripes_m[(h % table_size) % stripe_count];
+  }
+
+  // find key x with hash h, NULL if it's not there. the
+  // caller holds the stripe lock or an epoch guard.
+  Node* _find(string_view x, size_type h) const {
+    Node* node = table_m[h % table_size].load(memory_order_acquire);
+    while (node != NULL) {
+      if (node->hash_m == h && string_view(node->key_m) == x) {
+	return node;
+      }
+      node = node->next_m.load(memory_order_acquire);
+    }
+    return NULL;
+  }
+
+  // publish a new node at the head of its bucket,
+  // the caller holds the stripe lock.
+  void _push_front(const Key& k, size_type h, T* value) {
+    atomic<Node*>& head = table_m[h % table_size];
+    Node* node = new Node(k, h, value, head.load(memory_order_relaxed));
+    head.store(node, memory_order_release);
+    size_m.fetch_add(1, memory_order_relaxed);
+  }
+
+  static void _free_value(void* p) {
+    delete static_cast<T*>(p);
+  }
+
+  static void _free_node(void* p) {
+    delete static_cast<Node*>(p);
+  }
+
+  atomic<Node*>* table_m;
+  size_type table_size;
+  atomic<size_type> size_m;
+  mutex stripes_m[stripe_count];
+  // lookups pin an epoch, so it's changed by const members too.
+  mutable epoch_domain domain_m;
+};
+
+#endif // CONCURRENTMAP_HPP
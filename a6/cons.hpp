@@ -46,6 +46,16 @@ inline Cell* make_symbol(const char* const s)
   return new SymbolCell(s);
 }
 
+/**
+ * \brief Make a symbol cell.
+ * \param s The start of the symbol name to be stored in the new cell.
+ * \param length The number of characters in the name.
+ */
+inline Cell* make_symbol(const char* const s, size_t length)
+{
+  return new SymbolCell(s, length);
+}
+
 /**
  * \brief Make a conspair cell.
  * \param my_car The initial car pointer to be stored in the new cell.
@@ -60,10 +70,21 @@ inline Cell* cons(Cell* const my_car, Cell* const my_cdr)
  * \brief Make a procedure cell.
  * \param my_formals A list of the procedure's formal parameter names.
  * \param my_body The body (an expression) of the procedure.
+ * \param my_memo The result cache, if the procedure is memoized.
  */
-inline Cell* lambda(Cell* const my_formals, Cell* const my_body)
+inline Cell* lambda(Cell* const my_formals, Cell* const my_body, MemoTable* const my_memo = NULL)
 {
-  return new ProcedureCell(my_formals, my_body);
+  return new ProcedureCell(my_formals, my_body, my_memo);
+}
+
+/**
+ * \brief Make a procedure cell sharing prepared code.
+ * \param code The formals and body of the procedure.
+ * \param my_memo The result cache, if the procedure is memoized.
+ */
+inline Cell* lambda(ProcedureCode* const code, MemoTable* const my_memo = NULL)
+{
+  return new ProcedureCell(code->retain(), my_memo);
 }
 
 /**
@@ -176,6 +197,26 @@ inline Cell* get_formals(Cell* const c)
   return c->get_formals();
 }
 
+/**
+ * \brief Accessor (error if c is not a procedure cell).
+ * \return The result cache of the function pointed to by c, NULL if
+ * it is not memoized.
+ */
+inline MemoTable* get_memo(Cell* const c)
+{
+  return c->get_memo();
+}
+
+/**
+ * \brief Accessor (error if c is not a procedure cell).
+ * \return The formals and body shared by the copies of the function
+ * pointed to by c.
+ */
+inline ProcedureCode* get_code(Cell* const c)
+{
+  return c->get_code();
+}
+
 /**
  * \brief Accessor (error if c is not a procedure cell).
  * \return Pointer to the cons list containing the expression defining the
@@ -199,10 +240,14 @@ inline ostream& operator<<(ostream& os, const Cell& c)
 
 /**
  * \brief Make a PrimitiveCell.
+ * \param name Name of the operator.
+ * \param f The primitive procedure.
+ * \param min The minimum number of arguments.
+ * \param max The maximum number of arguments, by default there's no limit.
  */
-inline Cell* make_primitive(Cell *(*f)(Cell*)) 
+inline Cell* make_primitive(const char* const name, PrimitiveFunc f, int min, int max = NO_MAX_ARGS)
 {
-  return new PrimitiveCell(f);
+  return new PrimitiveCell(name, f, min, max);
 }
 
 /**
@@ -0,0 +1,40 @@
+/**
+ * Counting replacements of the global operator new and delete, for
+ * the benchmarks that report heap bytes per entry. Include it in one
+ * translation unit only.
+ */
+#ifndef ALLOCCOUNT_HPP
+#define ALLOCCOUNT_HPP
+
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+
+// the bytes currently allocated with new, as malloc rounds them up.
+static size_t live_bytes = 0;
+
+// new is malloc and delete is free here, which GCC can't see
+// when it warns about free on memory that came from new.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(size_t n) {
+  void* p = malloc(n ? n : 1);
+  if (p == NULL) throw std::bad_alloc();
+  live_bytes += malloc_usable_size(p);
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  if (p == NULL) return;
+  live_bytes -= malloc_usable_size(p);
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+#pragma GCC diagnostic pop
+
+#endif // ALLOCCOUNT_HPP
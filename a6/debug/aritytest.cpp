@@ -0,0 +1,44 @@
+/**
+ * Checks that the primitives accept exactly the numbers of operands
+ * they are declared with, including none for (0, 0) and any number
+ * for no maximum. Build with
+ *   g++ aritytest.cpp ../parse.cpp ../eval.cpp ../Cell.cpp ../frame.cpp ../memo.cpp ../output.cpp -o aritytest
+ */
+#include <iostream>
+#include <stdexcept>
+#include "../parse.hpp"
+#include "../eval.hpp"
+
+using namespace std;
+
+int failures = 0;
+
+// evaluate sexpr, and check whether it raised an error.
+void check(const string& sexpr, bool expect_error) {
+  bool raised = false;
+  try {
+    eval(parse(sexpr));
+  } catch (runtime_error& e) {
+    raised = true;
+  }
+  if (raised != expect_error) {
+    cout << "FAIL: " << sexpr << (expect_error ? " was accepted" : " raised an error") << endl;
+    ++failures;
+  }
+}
+
+int main() {
+  check("(frame-stats)", false);
+  check("(frame-stats 1)", true);
+  check("(frame-stats 1 2)", true);
+  check("(car (quote (1)))", false);
+  check("(car (quote (1)) 2)", true);
+  check("(cons 1)", true);
+  check("(memoize)", true);
+  check("(+)", false);
+  check("(+ 1 2 3 4 5 6 7 8 9 10)", false);
+  check("(/)", true);
+  check("(< 1 2 3)", false);
+  cout << (failures ? "failed" : "ok") << endl;
+  return failures ? 1 : 0;
+}
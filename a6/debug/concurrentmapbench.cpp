@@ -0,0 +1,82 @@
+/**
+ * Read scaling of concurrentmap against a hashtablemap behind one mutex:
+ * 1, 2, 4, ... threads look up the symbols of a global frame sized table
+ * at the same time, with no writers. Build with
+ *   g++ -O2 -pthread concurrentmapbench.cpp -o concurrentmapbench
+ */
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include "../hashtablemap.hpp"
+#include "../concurrentmap.hpp"
+
+using namespace std;
+
+const int SYMBOLS = 500;
+const int LOOKUPS = 2000000;
+
+// the baseline, every lookup takes the one lock.
+struct lockedmap {
+  hashtablemap<string, long> m;
+  mutable mutex lock;
+  bool find(const string& x, long& value) const {
+    lock_guard<mutex> guard(lock);
+    hashtablemap<string, long>::const_iterator it = m.find(x);
+    if (it == m.end()) return false;
+    value = it->second;
+    return true;
+  }
+};
+
+template <class Map>
+void look_up_all(const Map* m, const vector<string>* symbols, long* sink) {
+  long sum = 0;
+  for (int i=0; i<LOOKUPS; ++i) {
+    long value;
+    if (m->find((*symbols)[i % symbols->size()], value)) sum += value;
+  }
+  *sink = sum;
+}
+
+// million lookups per second, summed over all threads.
+template <class Map>
+double throughput(const Map& m, const vector<string>& symbols, int threads) {
+  vector<long> sinks(threads);
+  vector<thread> workers;
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for (int i=0; i<threads; ++i) {
+    workers.push_back(thread(look_up_all<Map>, &m, &symbols, &sinks[i]));
+  }
+  for (int i=0; i<threads; ++i) workers[i].join();
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  return static_cast<double>(LOOKUPS) * threads / elapsed.count() / 1e6;
+}
+
+int main() {
+  vector<string> symbols;
+  concurrentmap<string, long> shared;
+  lockedmap locked;
+  for (int i=0; i<SYMBOLS; ++i) {
+    stringstream ss;
+    ss << "symbol-" << i;
+    symbols.push_back(ss.str());
+    shared.insert(pair<string, long>(ss.str(), i));
+    locked.m.insert(pair<string, long>(ss.str(), i));
+  }
+  int max_threads = thread::hardware_concurrency();
+  if (max_threads < 8) max_threads = 8;
+  cout << thread::hardware_concurrency() << " hardware threads, "
+       << "million lookups per second" << endl;
+  cout << setw(8) << "threads" << setw(16) << "concurrentmap" << setw(16) << "locked" << endl;
+  for (int threads=1; threads<=max_threads; threads*=2) {
+    cout << setw(8) << threads << fixed << setprecision(1)
+	 << setw(16) << throughput(shared, symbols, threads)
+	 << setw(16) << throughput(locked, symbols, threads) << endl;
+  }
+  return 0;
+}
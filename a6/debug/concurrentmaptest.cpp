@@ -0,0 +1,129 @@
+/**
+ * Stress test of concurrentmap: writer threads insert, replace and erase
+ * while reader threads keep looking up the same keys. Every value holds
+ * the number of its key, so a reader that sees a freed or torn value
+ * notices. Build with
+ *   g++ -O2 -pthread concurrentmaptest.cpp -o concurrentmaptest
+ * and again with -fsanitize=thread or -fsanitize=address.
+ */
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <cstdlib>
+#include "../concurrentmap.hpp"
+
+using namespace std;
+
+const int WRITERS = 4;
+const int READERS = 4;
+const int KEYS_PER_WRITER = 200;
+const int SHARED_KEYS = 50;
+const int WRITES = 200000;
+
+// a value is its key's number times 1000000 plus a version.
+typedef long value_t;
+
+string key_name(const char* prefix, int i) {
+  stringstream ss;
+  ss << prefix << i;
+  return ss.str();
+}
+
+atomic<bool> done(false);
+atomic<long> errors(0);
+atomic<long> reads(0);
+
+// each writer owns its keys, and remembers what should be in the
+// map for them. the shared keys are written by every writer.
+void writer(concurrentmap<string, value_t>* m, int id, map<int, value_t>* expected) {
+  unsigned int seed = id + 1;
+  for (int w=0; w<WRITES; ++w) {
+    int k = rand_r(&seed) % KEYS_PER_WRITER;
+    int key_number = id * KEYS_PER_WRITER + k;
+    string key = key_name("own-", key_number);
+    value_t value = static_cast<value_t>(key_number) * 1000000 + w;
+    switch (rand_r(&seed) % 4) {
+    case 0:
+      if (m->insert(pair<string, value_t>(key, value)) != !expected->count(key_number)) {
+	++errors;
+      }
+      if (!expected->count(key_number)) (*expected)[key_number] = value;
+      break;
+    case 1:
+      m->insert_or_assign(key, value);
+      (*expected)[key_number] = value;
+      break;
+    case 2:
+      if (m->erase(key) != expected->count(key_number)) {
+	++errors;
+      }
+      expected->erase(key_number);
+      break;
+    default:
+      int s = rand_r(&seed) % SHARED_KEYS;
+      m->insert_or_assign(key_name("shared-", s), static_cast<value_t>(s) * 1000000 + w);
+    }
+  }
+}
+
+void reader(const concurrentmap<string, value_t>* m, int id) {
+  unsigned int seed = 1000 + id;
+  long n = 0;
+  while (!done.load()) {
+    int key_number;
+    string key;
+    if (rand_r(&seed) % 2) {
+      key_number = rand_r(&seed) % (WRITERS * KEYS_PER_WRITER);
+      key = key_name("own-", key_number);
+    }
+    else {
+      key_number = rand_r(&seed) % SHARED_KEYS;
+      key = key_name("shared-", key_number);
+    }
+    value_t value;
+    if (m->find(key, value) && value / 1000000 != key_number) {
+      ++errors;
+    }
+    ++n;
+  }
+  reads += n;
+}
+
+int main() {
+  concurrentmap<string, value_t> m(101);
+  vector<map<int, value_t> > expected(WRITERS);
+  vector<thread> readers, writers;
+  for (int i=0; i<READERS; ++i) {
+    readers.push_back(thread(reader, &m, i));
+  }
+  for (int i=0; i<WRITERS; ++i) {
+    writers.push_back(thread(writer, &m, i, &expected[i]));
+  }
+  for (int i=0; i<WRITERS; ++i) writers[i].join();
+  done.store(true);
+  for (int i=0; i<READERS; ++i) readers[i].join();
+
+  // with the writers done, the map holds exactly what they expect.
+  unsigned int size = SHARED_KEYS;
+  for (int i=0; i<WRITERS; ++i) {
+    for (int k=0; k<KEYS_PER_WRITER; ++k) {
+      int key_number = i * KEYS_PER_WRITER + k;
+      value_t value;
+      bool found = m.find(key_name("own-", key_number), value);
+      if (found != (expected[i].count(key_number) == 1) ||
+	  (found && value != expected[i][key_number])) {
+	++errors;
+      }
+    }
+    size += expected[i].size();
+  }
+  if (m.size() != size) ++errors;
+
+  cout << reads.load() << " reads, " << WRITERS * WRITES << " writes, "
+       << errors.load() << " errors" << endl;
+  return errors.load() ? 1 : 0;
+}
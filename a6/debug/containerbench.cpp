@@ -0,0 +1,176 @@
+/**
+ * Throughput and memory of the map containers on Scheme symbol sets:
+ * insert, lookup of present and absent keys, iteration and erase, in
+ * nanoseconds per operation, and the heap bytes the map holds per
+ * entry. Covers hashtablemap, a5's bstmap and bptreemap, std::map
+ * and std::unordered_map at 10 to 10^6 symbols.
+ *
+ * hashtablemap never grows its table by itself: it keeps its default
+ * 503 buckets unless reserve is called, so its chains get long past a
+ * few thousand symbols. The "hashtablemap" row measures it as the
+ * interpreter uses it, with the default buckets, and is left out past
+ * 10^5 symbols, where a lookup costs over 100 us. The "reserved" row
+ * calls reserve(n) before the inserts, outside of the timed region.
+ * Build with
+ *   g++ -O2 containerbench.cpp -o containerbench
+ * and pass a largest size to stop earlier, e.g. containerbench 10000.
+ */
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <chrono>
+#include <cstdlib>
+#include "../hashtablemap.hpp"
+#include "../../a5/bstmap.hpp"
+#include "../../a5/bptreemap.hpp"
+#include "alloccount.hpp"
+
+using namespace std;
+
+// n distinct symbols, made of a common prefix, a stem and
+// sometimes a number, e.g. list-ref, string-append2, x17.
+vector<string> make_symbols(int n, int seed) {
+  static const char* prefixes[] = {"", "", "list-", "string-", "vector-", "char-",
+				   "make-", "get-", "set-", "for-each-", "call-with-"};
+  static const char* stems[] = {"ref", "tail", "length", "append", "copy", "fill",
+				"iter", "first", "rest", "args", "n", "x", "y", "acc",
+				"loop", "helper", "test", "main", "result", "value"};
+  const int nprefixes = sizeof(prefixes) / sizeof(prefixes[0]);
+  const int nstems = sizeof(stems) / sizeof(stems[0]);
+  srand(seed);
+  unordered_map<string, int> seen;
+  vector<string> symbols;
+  while (static_cast<int>(symbols.size()) < n) {
+    string s = string(prefixes[rand() % nprefixes]) + stems[rand() % nstems];
+    if (rand() % 3 == 0 || seen.count(s)) {
+      stringstream ss;
+      ss << rand() % (n + 1);
+      s += ss.str();
+    }
+    if (seen.count(s)) continue;
+    seen[s] = 1;
+    symbols.push_back(s);
+  }
+  return symbols;
+}
+
+typedef chrono::steady_clock bench_clock;
+
+double elapsed_ns(bench_clock::time_point start) {
+  return chrono::duration<double, nano>(bench_clock::now() - start).count();
+}
+
+// a hashtablemap with a bucket for each symbol reserved up front.
+struct reserved_hashtablemap: public hashtablemap<string, int> {};
+
+// get a fresh map ready for n entries, only reserved maps do anything.
+template <class Map>
+void prepare(Map& /*m*/, size_t /*n*/) {}
+
+void prepare(reserved_hashtablemap& m, size_t n) {
+  m.reserve(n);
+}
+
+// the results of one container at one size.
+struct result {
+  double insert, hit, miss, iterate, erase;
+  double bytes_per_entry;
+};
+
+// volatile keeps the measured loops from being optimized away.
+volatile long sink;
+
+/**
+ * Time each operation over the symbols, repeated rounds times on
+ * fresh maps so that small sizes still run long enough to measure.
+ * The maps are destroyed outside of the timed regions.
+ */
+template <class Map>
+result measure(const vector<string>& symbols, const vector<string>& misses, int rounds) {
+  result r = {0, 0, 0, 0, 0, 0};
+  size_t n = symbols.size();
+  for (int k=0; k<rounds; ++k) {
+    size_t before = live_bytes;
+    Map* m = new Map;
+    prepare(*m, n);
+    bench_clock::time_point start = bench_clock::now();
+    for (size_t i=0; i<n; ++i) {
+      m->insert(pair<const string, int>(symbols[i], i));
+    }
+    r.insert += elapsed_ns(start);
+    r.bytes_per_entry = static_cast<double>(live_bytes - before) / n;
+
+    long found = 0;
+    start = bench_clock::now();
+    for (size_t i=0; i<n; ++i) {
+      found += m->count(symbols[i]);
+    }
+    r.hit += elapsed_ns(start);
+    start = bench_clock::now();
+    for (size_t i=0; i<n; ++i) {
+      found += m->count(misses[i]);
+    }
+    r.miss += elapsed_ns(start);
+
+    const Map& cm = *m;
+    start = bench_clock::now();
+    for (typename Map::const_iterator it=cm.begin(); it!=cm.end(); ++it) {
+      found += it->second;
+    }
+    r.iterate += elapsed_ns(start);
+
+    start = bench_clock::now();
+    for (size_t i=0; i<n; ++i) {
+      found += m->erase(symbols[i]);
+    }
+    r.erase += elapsed_ns(start);
+    sink = found;
+    delete m;
+  }
+  double ops = static_cast<double>(n) * rounds;
+  r.insert /= ops;
+  r.hit /= ops;
+  r.miss /= ops;
+  r.iterate /= ops;
+  r.erase /= ops;
+  return r;
+}
+
+template <class Map>
+void report(const char* name, const vector<string>& symbols,
+	    const vector<string>& misses, int rounds) {
+  result r = measure<Map>(symbols, misses, rounds);
+  cout << setw(14) << name << fixed << setprecision(1)
+       << setw(10) << r.insert << setw(10) << r.hit << setw(10) << r.miss
+       << setw(10) << r.iterate << setw(10) << r.erase
+       << setw(12) << r.bytes_per_entry << endl;
+}
+
+int main(int argc, char* argv[]) {
+  int largest = argc > 1 ? atoi(argv[1]) : 1000000;
+  for (int n=10; n<=largest; n*=10) {
+    vector<string> symbols = make_symbols(n, 1);
+    // same shape, but none of them is in the maps.
+    vector<string> misses = make_symbols(n, 2);
+    for (size_t i=0; i<misses.size(); ++i) misses[i] += "?";
+    int rounds = n < 1000000 ? 1000000 / n : 1;
+    cout << n << " symbols, ns per operation, bytes per entry" << endl;
+    cout << setw(14) << "map" << setw(10) << "insert" << setw(10) << "hit"
+	 << setw(10) << "miss" << setw(10) << "iterate" << setw(10) << "erase"
+	 << setw(12) << "bytes" << endl;
+    if (n <= 100000) {
+      report<hashtablemap<string, int> >("hashtablemap", symbols, misses, rounds);
+    }
+    report<reserved_hashtablemap>("reserved", symbols, misses, rounds);
+    report<bstmap<string, int> >("bstmap", symbols, misses, rounds);
+    report<bptreemap<string, int> >("bptreemap", symbols, misses, rounds);
+    report<map<string, int> >("std::map", symbols, misses, rounds);
+    report<unordered_map<string, int> >("unordered_map", symbols, misses, rounds);
+    cout << endl;
+  }
+  return 0;
+}
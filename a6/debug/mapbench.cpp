@@ -0,0 +1,95 @@
+/**
+ * Lookup throughput of the binding table candidates on symbol sets
+ * shaped like the global frame's: short identifiers, many sharing a
+ * prefix such as list- or get-. Build with
+ *   g++ -O2 mapbench.cpp -o mapbench
+ */
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include "../hashtablemap.hpp"
+#include "../robinhoodmap.hpp"
+#include "../swissmap.hpp"
+#include "../hamtmap.hpp"
+
+using namespace std;
+
+// n distinct symbols, made of a common prefix, a stem and
+// sometimes a number, e.g. list-ref, string-append2, x17.
+vector<string> make_symbols(int n, int seed) {
+  static const char* prefixes[] = {"", "", "list-", "string-", "vector-", "char-",
+				   "make-", "get-", "set-", "for-each-", "call-with-"};
+  static const char* stems[] = {"ref", "tail", "length", "append", "copy", "fill",
+				"iter", "first", "rest", "args", "n", "x", "y", "acc",
+				"loop", "helper", "test", "main", "result", "value"};
+  const int nprefixes = sizeof(prefixes) / sizeof(prefixes[0]);
+  const int nstems = sizeof(stems) / sizeof(stems[0]);
+  srand(seed);
+  hashtablemap<string, int> seen;
+  vector<string> symbols;
+  while (static_cast<int>(symbols.size()) < n) {
+    string s = string(prefixes[rand() % nprefixes]) + stems[rand() % nstems];
+    if (rand() % 3 == 0 || seen.count(s)) {
+      stringstream ss;
+      ss << rand() % (n + 1);
+      s += ss.str();
+    }
+    if (seen.count(s)) continue;
+    seen[s] = 1;
+    symbols.push_back(s);
+  }
+  return symbols;
+}
+
+// the number of lookups that found their key, printed at the
+// end so that the lookups can't be optimized away.
+long found = 0;
+
+// nanoseconds per lookup of each of the queries, repeated.
+template <class Map>
+double time_lookups(const vector<string>& symbols, const vector<string>& queries, int rounds) {
+  Map m;
+  for (size_t i=0; i<symbols.size(); ++i) {
+    m.insert(pair<string, int>(symbols[i], i));
+  }
+  clock_t start = clock();
+  for (int r=0; r<rounds; ++r) {
+    for (size_t i=0; i<queries.size(); ++i) {
+      found += m.count(queries[i]);
+    }
+  }
+  clock_t stop = clock();
+  return 1e9 * (stop - start) / CLOCKS_PER_SEC / (static_cast<double>(rounds) * queries.size());
+}
+
+template <class Map>
+void report(const char* name, const vector<string>& symbols, const vector<string>& misses, int rounds) {
+  cout << setw(14) << name
+       << setw(10) << fixed << setprecision(1) << time_lookups<Map>(symbols, symbols, rounds)
+       << setw(10) << time_lookups<Map>(symbols, misses, rounds) << endl;
+}
+
+int main() {
+  int sizes[] = {50, 500, 5000, 50000};
+  for (int k=0; k<4; ++k) {
+    int n = sizes[k];
+    vector<string> symbols = make_symbols(n, 1);
+    // same shape, but none of them is in the map.
+    vector<string> misses = make_symbols(n, 2);
+    for (size_t i=0; i<misses.size(); ++i) misses[i] += "?";
+    int rounds = 2000000 / n + 1;
+    cout << n << " symbols, ns per lookup" << endl;
+    cout << setw(14) << "map" << setw(10) << "hit" << setw(10) << "miss" << endl;
+    report<hashtablemap<string, int> >("hashtablemap", symbols, misses, rounds);
+    report<robinhoodmap<string, int> >("robinhoodmap", symbols, misses, rounds);
+    report<swissmap<string, int> >("swissmap", symbols, misses, rounds);
+    report<hamtmap<string, int> >("hamtmap", symbols, misses, rounds);
+    cout << endl;
+  }
+  cout << found << " lookups found their key" << endl;
+  return 0;
+}
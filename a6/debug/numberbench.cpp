@@ -0,0 +1,90 @@
+/**
+ * Number formatting of the cells: IntCell and DoubleCell to_str and
+ * print against the stringstream formatting they used to do, in ns
+ * per number. print writes into a stream that discards its output,
+ * so only the formatting is measured. Build with
+ *   g++ -O2 numberbench.cpp ../Cell.cpp ../memo.cpp -o numberbench
+ */
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include "../Cell.hpp"
+
+using namespace std;
+
+typedef chrono::steady_clock bench_clock;
+
+double elapsed_ns(bench_clock::time_point start) {
+  return chrono::duration<double, nano>(bench_clock::now() - start).count();
+}
+
+// a stream buffer that drops everything written to it.
+class null_buffer: public streambuf {
+protected:
+  virtual streamsize xsputn(const char* s, streamsize n) { return n; }
+  virtual int overflow(int c) { return c; }
+};
+
+// volatile keeps the measured loops from being optimized away.
+volatile size_t sink;
+
+template <class Format>
+void report(const char* name, const vector<Cell*>& cells, Format format) {
+  size_t total = 0;
+  bench_clock::time_point start = bench_clock::now();
+  for (size_t i=0; i<cells.size(); ++i) {
+    total += format(cells[i]);
+  }
+  double ns = elapsed_ns(start) / cells.size();
+  sink = total;
+  cout << setw(22) << name << fixed << setprecision(1) << setw(10) << ns << endl;
+}
+
+int main() {
+  const int n = 1000000;
+  mt19937 random(1);
+  uniform_int_distribution<int> ints(-1000000, 1000000);
+  uniform_real_distribution<double> doubles(-1000.0, 1000.0);
+  vector<Cell*> int_cells, double_cells;
+  for (int i=0; i<n; ++i) {
+    int_cells.push_back(new IntCell(ints(random)));
+    double_cells.push_back(new DoubleCell(doubles(random)));
+  }
+  null_buffer discard;
+  ostream out(&discard);
+
+  cout << setw(22) << "ns per number" << endl;
+  report("int stringstream", int_cells, [](const Cell* c) {
+      stringstream ss;
+      ss << c->get_int();
+      return ss.str().size();
+    });
+  report("int to_str", int_cells, [](const Cell* c) {
+      return c->to_str().size();
+    });
+  report("int print", int_cells, [&out](const Cell* c) {
+      c->print(out);
+      return static_cast<size_t>(1);
+    });
+  report("double stringstream", double_cells, [](const Cell* c) {
+      stringstream ss;
+      ss << setprecision(6) << showpoint << c->get_double();
+      return ss.str().size();
+    });
+  report("double to_str", double_cells, [](const Cell* c) {
+      return c->to_str().size();
+    });
+  report("double print", double_cells, [&out](const Cell* c) {
+      c->print(out);
+      return static_cast<size_t>(1);
+    });
+  for (int i=0; i<n; ++i) {
+    delete int_cells[i];
+    delete double_cells[i];
+  }
+  return 0;
+}
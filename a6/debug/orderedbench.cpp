@@ -0,0 +1,103 @@
+/**
+ * The ordered maps on large number tables: a5's bstmap and bptreemap
+ * against std::map, at 10^5 to 10^7 keys inserted in random order.
+ * Reports ns per insert, hit and miss lookup, iteration step and
+ * erase, and the heap bytes held per entry. Build with
+ *   g++ -O2 orderedbench.cpp -o orderedbench
+ * and pass a largest size to stop earlier, e.g. orderedbench 1000000.
+ */
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include "../../a5/bstmap.hpp"
+#include "../../a5/bptreemap.hpp"
+#include "alloccount.hpp"
+
+using namespace std;
+
+typedef chrono::steady_clock bench_clock;
+
+double elapsed_ns(bench_clock::time_point start) {
+  return chrono::duration<double, nano>(bench_clock::now() - start).count();
+}
+
+// volatile keeps the measured loops from being optimized away.
+volatile long sink;
+
+/**
+ * Build a map of the keys, then time lookups of every key and of
+ * as many absent ones, a walk over the map, and erasing every key.
+ */
+template <class Map>
+void report(const char* name, const vector<long>& keys, const vector<long>& misses) {
+  size_t n = keys.size();
+  size_t before = live_bytes;
+  Map* m = new Map;
+  bench_clock::time_point start = bench_clock::now();
+  for (size_t i=0; i<n; ++i) {
+    m->insert(pair<const long, long>(keys[i], i));
+  }
+  double insert = elapsed_ns(start);
+  double bytes = static_cast<double>(live_bytes - before) / n;
+
+  long found = 0;
+  start = bench_clock::now();
+  for (size_t i=0; i<n; ++i) {
+    found += m->count(keys[i]);
+  }
+  double hit = elapsed_ns(start);
+  start = bench_clock::now();
+  for (size_t i=0; i<n; ++i) {
+    found += m->count(misses[i]);
+  }
+  double miss = elapsed_ns(start);
+
+  const Map& cm = *m;
+  start = bench_clock::now();
+  for (typename Map::const_iterator it=cm.begin(); it!=cm.end(); ++it) {
+    found += it->second;
+  }
+  double iterate = elapsed_ns(start);
+
+  start = bench_clock::now();
+  for (size_t i=0; i<n; ++i) {
+    found += m->erase(keys[i]);
+  }
+  double erase = elapsed_ns(start);
+  sink = found;
+  delete m;
+
+  cout << setw(12) << name << fixed << setprecision(1)
+       << setw(10) << insert / n << setw(10) << hit / n << setw(10) << miss / n
+       << setw(10) << iterate / n << setw(10) << erase / n
+       << setw(12) << bytes << endl;
+}
+
+int main(int argc, char* argv[]) {
+  int largest = argc > 1 ? atoi(argv[1]) : 10000000;
+  mt19937 random(1);
+  for (int n=100000; n<=largest; n*=10) {
+    // even keys are in the map, odd ones are misses.
+    vector<long> keys(n), misses(n);
+    for (int i=0; i<n; ++i) {
+      keys[i] = 2L * i;
+      misses[i] = 2L * i + 1;
+    }
+    shuffle(keys.begin(), keys.end(), random);
+    shuffle(misses.begin(), misses.end(), random);
+    cout << n << " keys, ns per operation, bytes per entry" << endl;
+    cout << setw(12) << "map" << setw(10) << "insert" << setw(10) << "hit"
+	 << setw(10) << "miss" << setw(10) << "iterate" << setw(10) << "erase"
+	 << setw(12) << "bytes" << endl;
+    report<bstmap<long, long> >("bstmap", keys, misses);
+    report<bptreemap<long, long> >("bptreemap", keys, misses);
+    report<map<long, long> >("std::map", keys, misses);
+    cout << endl;
+  }
+  return 0;
+}
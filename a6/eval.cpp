@@ -4,16 +4,51 @@
  * Evaluate the s-expression tree parsed by parse.cpp and do error detection.
  */
 
+#include <unordered_map>
 #include "eval.hpp"
+#include "memo.hpp"
 
 
 /**
- * \brief Evaluate each element in expression.
- * \param expr Expression to be evaluated.
- * \return A new list with each element being the result of 
- * evaluating the corresponding element in expr.
+ * \brief Number of argument slots reserved on the stack of 
+ * each call. Calls with more arguments fall back to the heap.
  */
-Cell* eval_each(Cell* expr);
+const int STACK_ARGS_SIZE = 8;
+
+/**
+ * \brief Number of results a memoized function caches,
+ * unless given to memoize.
+ */
+const int DEFAULT_MEMO_CAPACITY = 1024;
+
+/**
+ * \brief Count the elements in an operand list.
+ * Error if expr is not a well-formed list.
+ * \param expr The operand list.
+ * \return The number of elements in expr.
+ */
+int count_args(Cell* expr);
+
+/**
+ * \brief Evaluate each element in expression into args.
+ * \param expr Expression to be evaluated, a well-formed list.
+ * \param args Buffer with at least len(expr) slots, the ith slot
+ * receives the result of evaluating the ith element in expr.
+ */
+void eval_each(Cell* expr, Cell** args);
+
+/**
+ * \brief Copy the elements of a well-formed list into args.
+ * \param list The list of values.
+ * \param args Buffer with at least len(list) slots.
+ */
+void list_to_args(Cell* list, Cell** args);
+
+/**
+ * \brief Build a new list out of the n values in args.
+ * \return The list (args[0] ... args[n-1]).
+ */
+Cell* args_to_list(Cell** args, int n);
 
 /**
  * \brief Evaluate if form. Error if there is less 
@@ -54,6 +89,33 @@ Cell* eval_define(Cell* c);
  */
 Cell* eval_lambda(Cell* c);
 
+/**
+ * \brief Code prepared for each lambda form evaluated so far, keyed
+ * on the cell its operands start at. Allocated once and never freed,
+ * so cells deleted during exit can still be forgotten.
+ */
+unordered_map<const Cell*, ProcedureCode*>* lambda_codes =
+  new unordered_map<const Cell*, ProcedureCode*>();
+
+/**
+ * \brief Release the code prepared for the lambda form whose operands
+ * start at c, if any. Called with each ConsCell about to be deleted,
+ * so that a new cell at the same address does not find the code.
+ */
+void forget_lambda_code(const Cell* c);
+
+/**
+ * \brief Copy the expressions in the body of a lambda form. 
+ * Each internal definition of a function, (define name (lambda ...)),
+ * is copied as a definition of the function built here once.
+ * A procedure doesn't capture the frame it is made in, so the
+ * function would be the same on every call of the enclosing one,
+ * and evaluating the definition now just shares the built function.
+ * \param expressions The expressions following the formals.
+ * \return The copied expressions.
+ */
+Cell* lift_defines(Cell* expressions);
+
 /**
  * \brief Check if formals is a well-formed formal parameter 
  * list. Throw an error if formals is not a well-formed list or
@@ -95,6 +157,19 @@ Cell* optimized_eval(Cell* expr);
  */
 Cell* apply(Cell* proce, Cell* args);
 
+/**
+ * \brief Apply proce to the n arguments stored in args.
+ * \return The value of applying the function to args.
+ */
+Cell* apply(Cell* proce, Cell** args, int n);
+
+/**
+ * \brief Push new_frame, whose argument slots are already
+ * filled, and evaluate the body of proce in it.
+ * \return The value of the function body.
+ */
+Cell* call_procedure(Cell* proce, Frame* new_frame);
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 /**
@@ -103,135 +178,93 @@ Cell* apply(Cell* proce, Cell* args);
  *
  */
 
-Cell* eval_addition(Cell* c) {
-  if (!check_form(c, 0)) {
-    throw runtime_error("malformed list for operator +");
-  }
+Cell* eval_addition(Cell** args, int n) {
   // identity value for addition.
   Cell* result = make_int(0);
-  while (!nullp(c)) {
-    Cell* operand = car(c);
-    result = operand->eval_addition(result);
-    c = cdr(c);
+  for (int i=0; i<n; ++i) {
+    result = args[i]->eval_addition(result);
   }
   return result;
 }
 
 
-Cell* eval_multi(Cell* c) {
-  if (!check_form(c, 0)) {
-    throw runtime_error("malformed list for operaotr *");
-  }
+Cell* eval_multi(Cell** args, int n) {
   // identity value for multiplication.
   Cell* result = make_int(1);
-  while (!nullp(c)) {
-    Cell* operand = car(c);
-    result = operand->eval_multi(result);
-    c = cdr(c);
+  for (int i=0; i<n; ++i) {
+    result = args[i]->eval_multi(result);
   }
   return result;
 }
 
 
-Cell* eval_divi(Cell* c) {
-  if (!check_form(c, 1)) {
-    throw runtime_error("operator / expects at least one operand.");
-  }
-  if (len(c) == 1) {
+Cell* eval_divi(Cell** args, int n) {
+  if (n == 1) {
     Cell* result = make_int(1);
-    Cell* operand = car(c);
-    result = operand->eval_divi(result);
+    result = args[0]->eval_divi(result);
     return result;
   }
   else {
-    Cell* result = car(c);
+    Cell* result = args[0];
     /**
      * raise the error, if the first operand is of wrong type.
      */
     if (!intp(result) && !doublep(result)) result->eval_divi(nil);
-    c = cdr(c);
-    while (!nullp(c)) {
-      Cell* operand = car(c);
-      result = operand->eval_divi(result);
-      c = cdr(c);
+    for (int i=1; i<n; ++i) {
+      result = args[i]->eval_divi(result);
     }
     return result;
   }
 }
 
 
-Cell* eval_subtra(Cell* c) {
-  if (!check_form(c, 1)) {
-    throw runtime_error("operator - expects at least one operand.");
-  }
-  if (len(c) == 1) {
+Cell* eval_subtra(Cell** args, int n) {
+  if (n == 1) {
     Cell* result = make_int(0);
-    Cell* operand = car(c);
-    result = operand->eval_subtra(result);
+    result = args[0]->eval_subtra(result);
     return result;
   }
   else {
-    Cell* result = car(c);
+    Cell* result = args[0];
     /**
      * raise the error, if the first operand is of wrong type.
      */
     if (!intp(result) && !doublep(result)) result->eval_subtra(nil);
-    c = cdr(c);
-    while (!nullp(c)) {
-      Cell* operand = car(c);
-      result = operand->eval_subtra(result);
-      c = cdr(c);
+    for (int i=1; i<n; ++i) {
+      result = args[i]->eval_subtra(result);
     }
     return result;
   }
 }
 
 
-Cell* eval_ceiling(Cell* c) {
-  if (!check_form(c, 1, 1)) {
-    throw runtime_error("operator ceiling expects one double operand.");
-  }
-  return (car(c))->eval_ceiling();  
+Cell* eval_ceiling(Cell** args, int /*n*/) {
+  return args[0]->eval_ceiling();
 }
 
 
-Cell* eval_floor(Cell* c) {
-  if (!check_form(c, 1, 1)) {
-    throw runtime_error("operator floor expects one double operand.");
-  }
-  return (car(c))->eval_floor();
+Cell* eval_floor(Cell** args, int /*n*/) {
+  return args[0]->eval_floor();
 }
 
 
-Cell* eval_cons(Cell* c) {
-  if (!check_form(c, 2, 2)) {
-    throw runtime_error("operator cons expects two operands.");
-  }
-  return cons(car(c), car(cdr(c)));
+Cell* eval_cons(Cell** args, int /*n*/) {
+  return cons(args[0], args[1]);
 }
 
 
-Cell* eval_car(Cell* c) {
-  if (!check_form(c, 1, 1)) {
-    throw runtime_error("operator car expects one list operand.");
-  }
-  return car(car(c));
+Cell* eval_car(Cell** args, int /*n*/) {
+  return car(args[0]);
 }
 
 
-Cell* eval_cdr(Cell* c) {
-  if (!check_form(c, 1, 1)) {
-    throw runtime_error("operator cdr expects one list operand.");
-  }
-  return cdr(car(c));
+Cell* eval_cdr(Cell** args, int /*n*/) {
+  return cdr(args[0]);
 }
 
 
-Cell* eval_nullp(Cell* c) {
-  if (!check_form(c, 1, 1)) {
-    throw runtime_error("operator nullp expects one operand.");
-  }
-  if (nullp(car(c))) {
+Cell* eval_nullp(Cell** args, int /*n*/) {
+  if (nullp(args[0])) {
     return make_int(1);
   }
   else {
@@ -240,96 +273,140 @@ Cell* eval_nullp(Cell* c) {
 }
 
 
-Cell* eval_eval(Cell* c) {
-  if (!check_form(c, 1, 1)) {
-    throw runtime_error("operator eval expects one operand.");
-  }  
-  Cell* result = eval(car(c));
+Cell* eval_eval(Cell** args, int /*n*/) {
+  Cell* result = eval(args[0]);
   return result;
 }
 
 
-Cell* eval_print(Cell* c) {
-  if (!check_form(c, 1, 1)) {
-    throw runtime_error("operator print expects one operand.");
-  }
-  cout << *(car(c)) << endl;
+Cell* eval_print(Cell** args, int /*n*/) {
+  cout << *(args[0]) << '\n';
   return nil;
 }
 
 
-Cell* eval_not(Cell* const c) {
-  if (!check_form(c, 1, 1)) {
-    throw runtime_error("operator not expects one operand.");
-  }
-  int ans = (car(c))->truth() ? 0 : 1;
+Cell* eval_not(Cell** args, int /*n*/) {
+  int ans = args[0]->truth() ? 0 : 1;
   return make_int(ans);
 }
 
 
-Cell* eval_less_than(Cell* c) {
-  if (!check_form(c, 0)) {
-    throw runtime_error("malformed list for operaotr <.");
-  }
-  Cell* smaller_cell = nil;
-  if (!nullp(c)) {
-    smaller_cell = car(c);
-    /**
-     * to make sure that the first cell is of the right type,
-     * in case there is only one operand.
-     *
-     */
-    Cell* tmp_compare_cell = make_int(1);
-    smaller_cell->less_than(tmp_compare_cell);
-    delete tmp_compare_cell;
-    c = cdr(c);
+Cell* eval_less_than(Cell** args, int n) {
+  if (n == 0) {
+    return make_int(1);
   }
+  Cell* smaller_cell = args[0];
+  /**
+   * to make sure that the first cell is of the right type,
+   * in case there is only one operand.
+   *
+   */
+  Cell* tmp_compare_cell = make_int(1);
+  smaller_cell->less_than(tmp_compare_cell);
+  delete tmp_compare_cell;
   int ans = 1;
-  while (!nullp(c)) {
-    Cell* bigger_cell = car(c);
+  for (int i=1; i<n; ++i) {
+    Cell* bigger_cell = args[i];
     if (!smaller_cell->less_than(bigger_cell)) {
       ans = 0;
     }
     smaller_cell = bigger_cell;
-    c = cdr(c);
   }
   return make_int(ans);
 }
 
 
-Cell* eval_apply(Cell* c) {
-  if (!check_form(c, 2, 2)) {
-    throw runtime_error("operator apply expects exactly two operands.");
+Cell* eval_apply(Cell** args, int /*n*/) {
+  return apply(args[0], args[1]);
+}
+
+
+Cell* eval_memoize(Cell** args, int n) {
+  Cell* proce = args[0];
+  if (!procedurep(proce)) {
+    throw runtime_error("operator memoize expects a user defined function: " + proce->to_str());
+  }
+  int capacity = DEFAULT_MEMO_CAPACITY;
+  if (n == 2) {
+    if (!intp(args[1]) || get_int(args[1]) <= 0) {
+      throw runtime_error("operator memoize expects a positive int capacity: " + args[1]->to_str());
+    }
+    capacity = get_int(args[1]);
+  }
+  // share the code of proce, only the cache is new.
+  return lambda(get_code(proce), new MemoTable(capacity));
+}
+
+
+Cell* eval_memo_stats(Cell** args, int /*n*/) {
+  MemoTable* memo = NULL;
+  if (procedurep(args[0])) memo = get_memo(args[0]);
+  if (memo == NULL) {
+    throw runtime_error("operator memo-stats expects a memoized function: " + args[0]->to_str());
+  }
+  return cons(make_int(memo->hits()), 
+	      cons(make_int(memo->misses()), 
+		   cons(make_int(memo->size()), nil)));
+}
+
+
+Cell* eval_frame_stats(Cell** /*args*/, int /*n*/) {
+  cout << "global: " << env->global_frame()->binding_stats() << '\n';
+  return nil;
+}
+
+
+Cell* eval_sample_frame_stats(Cell** args, int /*n*/) {
+  if (!intp(args[0]) || get_int(args[0]) < 0) {
+    throw runtime_error("operator sample-frame-stats expects a non-negative int: " + args[0]->to_str());
+  }
+  Frame::sample_stats(get_int(args[0]));
+  return nil;
+}
+
+
+Cell* eval_set_print_limits(Cell** args, int /*n*/) {
+  for (int i=0; i<2; ++i) {
+    if (!intp(args[i]) || get_int(args[i]) < 0) {
+      throw runtime_error("operator set-print-limits expects a non-negative int: " + args[i]->to_str());
+    }
   }
-  Cell* proce = car(c);
-  Cell* args = car(cdr(c));
-  return apply(proce, args);
+  Cell::set_print_limits(get_int(args[0]), get_int(args[1]));
+  return nil;
 }
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 
 
 /**
- * \brief bind symbols to primitive procedures in the global env.
+ * \brief bind symbols to primitive procedures in the global env,
+ * together with the minimum and maximum number of operands
+ * each of them accepts (no maximum if omitted).
  */
 Env* init_env() {
   Env *env = new Env();
   Frame* global_f = env->top_frame();
-  global_f->define("+", make_primitive(eval_addition));
-  global_f->define("*", make_primitive(eval_multi));
-  global_f->define("/", make_primitive(eval_divi));
-  global_f->define("-", make_primitive(eval_subtra));
-  global_f->define("ceiling", make_primitive(eval_ceiling));
-  global_f->define("floor", make_primitive(eval_floor));
-  global_f->define("cons", make_primitive(eval_cons));
-  global_f->define("car", make_primitive(eval_car));
-  global_f->define("cdr", make_primitive(eval_cdr));
-  global_f->define("nullp", make_primitive(eval_nullp));
-  global_f->define("eval", make_primitive(eval_eval));
-  global_f->define("print", make_primitive(eval_print));
-  global_f->define("not", make_primitive(eval_not));
-  global_f->define("<", make_primitive(eval_less_than));
-  global_f->define("apply", make_primitive(eval_apply));
+  ConsCell::set_delete_hook(forget_lambda_code);
+  global_f->define("+", make_primitive("+", eval_addition, 0));
+  global_f->define("*", make_primitive("*", eval_multi, 0));
+  global_f->define("/", make_primitive("/", eval_divi, 1));
+  global_f->define("-", make_primitive("-", eval_subtra, 1));
+  global_f->define("ceiling", make_primitive("ceiling", eval_ceiling, 1, 1));
+  global_f->define("floor", make_primitive("floor", eval_floor, 1, 1));
+  global_f->define("cons", make_primitive("cons", eval_cons, 2, 2));
+  global_f->define("car", make_primitive("car", eval_car, 1, 1));
+  global_f->define("cdr", make_primitive("cdr", eval_cdr, 1, 1));
+  global_f->define("nullp", make_primitive("nullp", eval_nullp, 1, 1));
+  global_f->define("eval", make_primitive("eval", eval_eval, 1, 1));
+  global_f->define("print", make_primitive("print", eval_print, 1, 1));
+  global_f->define("not", make_primitive("not", eval_not, 1, 1));
+  global_f->define("<", make_primitive("<", eval_less_than, 0));
+  global_f->define("apply", make_primitive("apply", eval_apply, 2, 2));
+  global_f->define("memoize", make_primitive("memoize", eval_memoize, 1, 2));
+  global_f->define("memo-stats", make_primitive("memo-stats", eval_memo_stats, 1, 1));
+  global_f->define("frame-stats", make_primitive("frame-stats", eval_frame_stats, 0, 0));
+  global_f->define("sample-frame-stats", make_primitive("sample-frame-stats", eval_sample_frame_stats, 1, 1));
+  global_f->define("set-print-limits", make_primitive("set-print-limits", eval_set_print_limits, 2, 2));
   return env;
 }
 
@@ -358,7 +435,7 @@ Cell* optimized_eval(Cell* expr)
   }
   
   if (symbolp(expr)) {
-    return env->lookup(get_symbol(expr));
+    return env->lookup(expr->get_symbol_name());
   }
   
   if (!listp(expr)) {
@@ -392,13 +469,13 @@ Cell* optimized_eval(Cell* expr)
       return eval_lambda(body);
     }
     else if (form == "let") {
-      env->push((env->top_frame())->make_new_frame(nil, nil));
+      env->push((env->top_frame())->make_new_frame(nil, 0));
       try {
 	expr = eval_let(body);
       }
-      catch (runtime_error e) {
+      catch (...) {
 	env->pop();
-	throw e;
+	throw;
       }
       env->pop();
       return expr;
@@ -408,77 +485,237 @@ Cell* optimized_eval(Cell* expr)
   /**
    * evaluate combinations.
    */
-  Cell* args = eval_each(body);
+  int n = count_args(body);
   Cell* proce = optimized_eval(oper);
 
-  expr = apply(proce, args);
-  //  if (!nullp(args)) delete args;
-  //  if (!nullp(proce)) delete proce;
+  if (procedurep(proce) && !symbolp(get_formals(proce))) {
+    /**
+     * evaluate the arguments of a user
+     * defined function directly into the
+     * slots of its new frame.
+     */
+    Frame* new_frame = (env->top_frame())->make_new_frame(get_formals(proce), n);
+    try {
+      eval_each(body, new_frame->arg_slots());
+    }
+    catch (...) {
+      delete new_frame;
+      throw;
+    }
+    return call_procedure(proce, new_frame);
+  }
+
+  /**
+   * otherwise the arguments are evaluated
+   * into a buffer on the stack, unless
+   * there are too many of them.
+   */
+  Cell* stack_args[STACK_ARGS_SIZE];
+  Cell** args = (n <= STACK_ARGS_SIZE) ? stack_args : new Cell*[n];
+  try {
+    eval_each(body, args);
+    expr = apply(proce, args, n);
+  }
+  catch (...) {
+    if (args != stack_args) delete [] args;
+    throw;
+  }
+  if (args != stack_args) delete [] args;
   return expr;
     // }
 }
 
 Cell* apply(Cell* proce, Cell* args) {
+  int n = count_args(args);
+  Cell* stack_args[STACK_ARGS_SIZE];
+  Cell** arg_array = (n <= STACK_ARGS_SIZE) ? stack_args : new Cell*[n];
   Cell* expr = nil;
+  list_to_args(args, arg_array);
+  try {
+    expr = apply(proce, arg_array, n);
+  }
+  catch (...) {
+    if (arg_array != stack_args) delete [] arg_array;
+    throw;
+  }
+  if (arg_array != stack_args) delete [] arg_array;
+  return expr;
+}
+
+Cell* apply(Cell* proce, Cell** args, int n) {
   if (is_primitive(proce)) {
-    expr = proce->call(args);
-    return expr;
+    return proce->call(args, n);
   }
   else if (procedurep(proce)) {
     /**
-     * Push a new frame whose parents
+     * Make a new frame whose parents
      * is the top frame currently in 
      * the env. Bind args to proce's 
-     * formal parameter list.
+     * formal parameters.
      *
      */
-    env->push((env->top_frame())->make_new_frame(get_formals(proce), args));
-
-    try {
-      expr = optimized_eval(get_body(proce));
+    Cell* formals = get_formals(proce);
+    Frame* new_frame = (env->top_frame())->make_new_frame(formals, n);
+    Cell** slots = new_frame->arg_slots();
+    if (symbolp(formals)) {
+      slots[0] = args_to_list(args, n);
     }
-    catch (runtime_error e) {
-      /**
-       * pop previous calling stacks when
-       * exceptions ocurr in user defined
-       * functions. to make the calling
-       * stack properly pop.
-       *
-       */
-      env->pop();
-
-      throw e;
+    else {
+      for (int i=0; i<n; ++i) {
+	slots[i] = args[i];
+      }
     }
-    env->pop();
-    return expr;
+    return call_procedure(proce, new_frame);
   }
   else {
     throw runtime_error("cannot call a value that is not a function: " + proce->to_str());
   }
 }
 
-Cell* eval_each(Cell* expr) {
-  if (nullp(expr)) {
-    return nil;
+Cell* call_procedure(Cell* proce, Frame* new_frame) {
+  Cell* expr = nil;
+  /**
+   * a memoized function first looks for
+   * the result of earlier calls with the
+   * same arguments.
+   */
+  MemoTable* memo = get_memo(proce);
+  string key;
+  if (memo != NULL) {
+    if (!MemoTable::make_key(new_frame->arg_slots(), new_frame->arg_count(), key)) {
+      memo = NULL;
+    }
+    else if ((expr = memo->look_up(key)) != NULL) {
+      delete new_frame;
+      return expr;
+    }
   }
-  else if (listp(expr)) {
-    Cell* car_cell = optimized_eval(car(expr));    
+  env->push(new_frame);
+  try {
+    expr = optimized_eval(get_body(proce));
+  }
+  catch (...) {
+    /**
+     * pop previous calling stacks when
+     * exceptions ocurr in user defined
+     * functions. to make the calling
+     * stack properly pop.
+     *
+     */
+    env->pop();
+
+    throw;
+  }
+  env->pop();
+  if (memo != NULL) memo->insert(key, expr);
+  return expr;
+}
+
+int count_args(Cell* expr) {
+  int n = 0;
+  while (!nullp(expr)) {
+    if (!listp(expr)) {
+      throw runtime_error("malformed expression.");
+    }
+    ++n;
     expr = cdr(expr);
-    return cons(car_cell, eval_each(expr));
   }
-  else {
-    throw runtime_error("malformed expression.");
+  return n;
+}
+
+void eval_each(Cell* expr, Cell** args) {
+  while (!nullp(expr)) {
+    *args = optimized_eval(car(expr));
+    ++args;
+    expr = cdr(expr);
   }
 }
 
+void list_to_args(Cell* list, Cell** args) {
+  while (!nullp(list)) {
+    *args = car(list);
+    ++args;
+    list = cdr(list);
+  }
+}
+
+Cell* args_to_list(Cell** args, int n) {
+  Cell* list = nil;
+  for (int i=n-1; i>=0; --i) {
+    list = cons(args[i], list);
+  }
+  return list;
+}
+
 Cell* eval_lambda(Cell* const c) {
+  /**
+   * the formals and body are checked and 
+   * prepared the first time the lambda
+   * form is evaluated, and kept in c.
+   * later each evaluation only makes a
+   * procedure sharing the code.
+   */
+  unordered_map<const Cell*, ProcedureCode*>::iterator it = lambda_codes->find(c);
+  if (it != lambda_codes->end()) {
+    return lambda(it->second);
+  }
   if (!check_form(c, 2)) {
     throw runtime_error("operator lambda expects at least two operands");
   }
   Cell* my_formals = (car(c))->copy();
-  check_formals(my_formals);
-  Cell* my_body = cons(make_symbol("begin"), (cdr(c))->copy());
-  return lambda(my_formals, my_body);
+  try {
+    check_formals(my_formals);
+  }
+  catch (...) {
+    if (!nullp(my_formals)) delete my_formals;
+    throw;
+  }
+  Cell* my_body = cons(make_symbol("begin"), lift_defines(cdr(c)));
+  ProcedureCode* code = new ProcedureCode(my_formals, my_body);
+  (*lambda_codes)[c] = code;
+  return lambda(code);
+}
+
+void forget_lambda_code(const Cell* c) {
+  if (lambda_codes->empty()) return;
+  unordered_map<const Cell*, ProcedureCode*>::iterator it = lambda_codes->find(c);
+  if (it != lambda_codes->end()) {
+    // erase first, releasing the code deletes
+    // its body, which forgets the forms in it.
+    ProcedureCode* code = it->second;
+    lambda_codes->erase(it);
+    code->release();
+  }
+}
+
+Cell* lift_defines(Cell* expressions) {
+  if (nullp(expressions)) {
+    return nil;
+  }
+  Cell* expr = car(expressions);
+  Cell* lifted = NULL;
+  try {
+    if (listp(expr) && !nullp(expr) && symbolp(car(expr))
+	&& get_symbol(car(expr)) == "define" && len(expr) == 3) {
+      Cell* name = car(cdr(expr));
+      Cell* value = car(cdr(cdr(expr)));
+      if (symbolp(name) && listp(value) && !nullp(value)
+	  && symbolp(car(value)) && get_symbol(car(value)) == "lambda") {
+	lifted = cons(make_symbol("define"), 
+		      cons(name->copy(), cons(eval_lambda(cdr(value)), nil)));
+      }
+    }
+  }
+  catch (runtime_error&) {
+    /**
+     * a malformed definition is left as
+     * it is, to report the error when it
+     * is evaluated.
+     */
+    lifted = NULL;
+  }
+  if (lifted == NULL) lifted = expr->copy();
+  return cons(lifted, lift_defines(cdr(expressions)));
 }
 
 void check_formals(Cell* formals) {
@@ -550,12 +787,12 @@ Cell* eval_if(Cell* c) {
     }
     else {
       if (!nullp(condition)) delete condition;
-      return (car(cdr(clause)))->copy();
+      return car(cdr(clause));
     }
   }
   else {
     if (!nullp(condition)) delete condition;
-    return (car(clause))->copy();
+    return car(clause);
   }
 }
 
@@ -13,6 +13,11 @@
 
 using namespace std;
 
+/**
+ * \brief The runtime stack, made by init_env.
+ */
+extern Env* env;
+
 /**
  * \brief Evaluate the expression tree whose root is pointed to by c
  * (error if c does not hold a well-formed expression).
@@ -14,63 +14,111 @@
 
 using namespace std;
 
-Frame::Frame(Frame* parent_frame):
+int Frame::sample_interval = 0;
+int Frame::frames_destroyed = 0;
+
+Frame::Frame(Frame* parent_frame, Cell* my_formals, int my_slot_count):
   parent(parent_frame),
-  bindings(hashtablemap<string, Cell*>())
-{}
+  formals(my_formals),
+  slot_count(my_slot_count),
+  bindings()
+{
+  if (slot_count <= LOCAL_SLOTS) {
+    slots = local_slots;
+  }
+  else {
+    slots = new Cell*[slot_count];
+  }
+  for (int i=0; i<slot_count; ++i) {
+    slots[i] = nil;
+  }
+}
 
 Frame::~Frame() {
-  for (hashtablemap<string, Cell*>::iterator i=bindings.begin(); i!=bindings.end(); ++i) {
+  if (parent != NULL && sample_interval > 0 
+      && ++frames_destroyed % sample_interval == 0) {
+    cerr << "frame " << frames_destroyed << ": " << bindings.stats() << endl;
+  }
+  for (int i=0; i<slot_count; ++i) {
+    if (slots[i] != nil) delete slots[i];
+  }
+  if (slots != local_slots) delete [] slots;
+  for (BindingMap::iterator i=bindings.begin(); i!=bindings.end(); ++i) {
     if (i->second != nil) delete i->second;
   }
 }
 
-Frame* Frame::make_new_frame(Cell* formals, Cell* args) {
+Frame* Frame::make_new_frame(Cell* formals, int n) {
   /**
    * If formals is a symbol, then the
    * function accept arbitrary number
-   * of arguments. Simply bind the arg
-   * list to the parameter.
+   * of arguments. The only slot is for
+   * the arg list.
    */
   if (formals->is_symbol()) {
-    Frame* new_frame = new Frame(this);
-    new_frame->define(formals->get_symbol(), args);
-    return new_frame;
+    return new Frame(this, formals, 1);
   }
   /**
    *
-   * First check if the number of arguments
+   * Check if the number of arguments
    * given matches the number of formal
    * parameter required by formals.
    *
    */
-  else if (formals->len() > args->len()) {
+  int formals_count = 0;
+  for (Cell* f=formals; f!=nil; f=f->get_cdr()) {
+    ++formals_count;
+  }
+  if (formals_count > n) {
     throw runtime_error("too few arguments given");
   }
-  else if (formals->len() < args->len()) {
+  else if (formals_count < n) {
     throw runtime_error("too many arguments given");
   }
   /**
    *
    * Make a new frame whose parent is 
-   * this frame. Bind values in args
-   * to corresponding parameters in
-   * formals.
+   * this frame. The caller stores the
+   * values of arguments into its slots.
    *
    */
-  Frame* new_frame = new Frame(this);
-  while (formals != nil) {
-    new_frame->define((formals->get_car())->get_symbol(), args->get_car());
-    formals = formals->get_cdr();
-    args = args->get_cdr();
+  return new Frame(this, formals, formals_count);
+}
+
+Cell** Frame::arg_slots() {
+  return slots;
+}
+
+int Frame::arg_count() const {
+  return slot_count;
+}
+
+Cell** Frame::find_slot(string_view name) {
+  // frames without slots, such as the global frame
+  // (made before nil is initialized), never touch formals.
+  if (slot_count == 0) {
+    return NULL;
   }
-  return new_frame;
+  else if (formals->is_symbol()) {
+    if (name == formals->get_symbol_name()) return slots;
+    return NULL;
+  }
+  Cell* f = formals;
+  for (int i=0; i<slot_count; ++i) {
+    if (name == (f->get_car())->get_symbol_name()) return slots + i;
+    f = f->get_cdr();
+  }
+  return NULL;
 }
 
-Cell* Frame::look_up(string name) {
-  if (bindings.count(name)) {
-    Cell* bound_value = bindings[name];
-    return bound_value->copy();
+Cell* Frame::look_up(string_view name) {
+  Cell** slot = find_slot(name);
+  if (slot != NULL) {
+    return (*slot)->copy();
+  }
+  BindingMap::iterator it = bindings.find(name);
+  if (it != bindings.end()) {
+    return it->second->copy();
   }
   else if (parent != NULL) {
     /**
@@ -82,17 +130,33 @@ Cell* Frame::look_up(string name) {
     return parent->look_up(name);
   }
   else {
-    throw runtime_error("undefined variable " + name);
+    throw runtime_error("undefined variable " + string(name));
   }
 }
 
 void Frame::define(string name, Cell* value) {
-  if (bindings.count(name)) {
+  if (find_slot(name) != NULL || 
+      !bindings.try_emplace(std::move(name), value).second) {
+    // name is only moved from if it was inserted.
     throw runtime_error("cannot redefine symbol " + name);
   }
-  else {
-    bindings.insert(pair<string, Cell*>(name, value));
-  }
+}
+
+map_stats Frame::binding_stats() const {
+  return bindings.stats();
+}
+
+Frame::BindingMap Frame::snapshot() const {
+  return bindings;
+}
+
+void Frame::restore(const BindingMap& saved) {
+  bindings = saved;
+}
+
+void Frame::sample_stats(int n) {
+  sample_interval = n;
+  frames_destroyed = 0;
 }
 
 Env::Env(): 
@@ -107,7 +171,7 @@ Env::~Env() {
   }
 }
 
-Cell* Env::lookup(string name) const {
+Cell* Env::lookup(string_view name) const {
   return (top->current)->look_up(name);
 }
 
@@ -129,3 +193,11 @@ void Env::push(Frame* new_frame) {
 Frame* Env::top_frame() const {
   return top->current;
 }
+
+Frame* Env::global_frame() const {
+  FrameList* bottom = top;
+  while (bottom->prev != NULL) {
+    bottom = bottom->prev;
+  }
+  return bottom->current;
+}
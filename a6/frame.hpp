@@ -10,22 +10,78 @@
 
 #include <map>
 #include <string>
+#include <string_view>
 #include "Cell.hpp"
-#include "hashtablemap.hpp"
+#include "hamtmap.hpp"
+#include "mapstats.hpp"
+#include "robinhoodmap.hpp"
+#include "swissmap.hpp"
 
 /**
  * \class Frame
  * \brief frame of runtime stack.
  */
 class Frame {
+public:
+  /**
+   * binding table of the names defined
+   * in a frame, starts empty and grows
+   * with the number of names. build with
+   * -DSWISS_BINDINGS to use the group
+   * probing table, which looks up faster
+   * once there are thousands of names, or
+   * -DHAMT_BINDINGS to use the persistent
+   * trie, whose snapshots are O(1).
+   */
+#if defined(SWISS_BINDINGS)
+  typedef swissmap<std::string, Cell*> BindingMap;
+  static const bool cheap_snapshots = false;
+#elif defined(HAMT_BINDINGS)
+  typedef hamtmap<std::string, Cell*> BindingMap;
+  static const bool cheap_snapshots = true;
+#else
+  typedef robinhoodmap<std::string, Cell*> BindingMap;
+  static const bool cheap_snapshots = false;
+#endif
+
 private:
   Frame* parent;
-  hashtablemap<std::string, Cell*> bindings;
+  /**
+   * the formal parameters of the
+   * function this frame is made for,
+   * either a list of symbols or a
+   * single symbol. arguments are kept
+   * in slots in the same order, so
+   * binding them needs no hashing.
+   */
+  Cell* formals;
+  int slot_count;
+  Cell** slots;
+  // slots for functions with few parameters
+  // live in the frame itself.
+  static const int LOCAL_SLOTS = 4;
+  Cell* local_slots[LOCAL_SLOTS];
+  BindingMap bindings;
+
+  /**
+   * every sample_interval-th procedure
+   * frame prints the stats of its binding
+   * table when it's destroyed, none if 0.
+   */
+  static int sample_interval;
+  static int frames_destroyed;
+
+  /**
+   * \brief Find the argument slot bound to name.
+   * \return Pointer to the slot, NULL if name is not a formal parameter.
+   */
+  Cell** find_slot(std::string_view name);
+
 public:
   /**
    * \brief Constructor.
    */
-  Frame (Frame* parent_frame=NULL);
+  Frame (Frame* parent_frame=NULL, Cell* my_formals=nil, int my_slot_count=0);
 
   /**
    * \brief Destructor.
@@ -33,12 +89,26 @@ public:
   ~Frame ();
   
   /**
-   * \brief Make a new frame for calling user defined function,
-   * bind all arguments to the formal parameters in the new frame.
-   * (error if the number of args doesn't equal to number of formals).
+   * \brief Make a new frame for calling user defined function
+   * with n arguments. The arguments are to be stored in arg_slots()
+   * of the new frame, in the order of the formal parameters.
+   * If formals is a single symbol, there's only one slot, holding
+   * the list of all arguments.
+   * (error if n doesn't equal to number of formals).
    * \return Pointer to the new frame.
    */
-  Frame* make_new_frame(Cell* formals, Cell* args);
+  Frame* make_new_frame(Cell* formals, int n);
+
+  /**
+   * \brief The argument slots of this frame, initially all nil.
+   * \return Array of the values bound to the formal parameters.
+   */
+  Cell** arg_slots();
+
+  /**
+   * \brief The number of argument slots of this frame.
+   */
+  int arg_count() const;
 
   /**
    * \brief Look up the value bound to the name from current
@@ -46,13 +116,39 @@ public:
    * (error if no value bound to the name).
    * \return the Cell bound to the name.
    */ 
-  Cell* look_up(std::string name);
+  Cell* look_up(std::string_view name);
 
   /**
    * \brief Bind value to the name in the current frame's
-   * binding table. (error if the name is already bound to sth).
+   * binding table, moving the name into it.
+   * (error if the name is already bound to sth).
    */
   void define(std::string name, Cell* value);
+
+  /**
+   * \brief The occupancy and probe length statistics
+   * of the frame's binding table.
+   */
+  map_stats binding_stats() const;
+
+  /**
+   * \brief A copy of the frame's binding table as it is now, which
+   * is O(1) if cheap_snapshots. Later definitions don't change it.
+   */
+  BindingMap snapshot() const;
+
+  /**
+   * \brief Put back the bindings of a snapshot of this frame.
+   * Values bound since the snapshot are dropped, not deleted, as
+   * other snapshots may still hold them.
+   */
+  void restore(const BindingMap& saved);
+
+  /**
+   * \brief Print the binding table stats of every n-th procedure
+   * frame to standard error when it's destroyed, or stop if n is 0.
+   */
+  static void sample_stats(int n);
 };
 
 /**
@@ -108,7 +204,7 @@ public:
    * parent frames. (error if the name binds to no value).
    * \return The value bound to the name.
    */
-  Cell* lookup(std::string name) const;
+  Cell* lookup(std::string_view name) const;
 
   /**
    * \brief The top frame in the stack.
@@ -116,6 +212,12 @@ public:
    */
   Frame* top_frame() const;
 
+  /**
+   * \brief The bottom frame in the stack.
+   * \return The global frame.
+   */
+  Frame* global_frame() const;
+
 };
 
 #endif // FRAME_HPP
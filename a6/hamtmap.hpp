@@ -0,0 +1,665 @@
+/**
+ * \file hamtmap.hpp
+ *
+ * A persistent map implemented as a hash array mapped trie. Each level
+ * of the trie branches on five more bits of the hash of the key, and a
+ * node only stores the branches in use, found through a bitmap. Nodes
+ * and entries are reference counted and shared, so copying a map takes
+ * constant time, and the copies share structure until one of them is
+ * changed. A change copies only the shared nodes on the path to the
+ * entry it touches. Keys are strings. The interface is the same as
+ * hashtablemap's, except that entries can't be changed through
+ * iterators, as they may belong to other copies too.
+ */
+
+#ifndef HAMTMAP_HPP
+#define HAMTMAP_HPP
+
+#include <iterator>
+#include <new>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include "mapstats.hpp"
+#include "strhash.hpp"
+using namespace std;
+
+template <class Key, class T>
+class hamtmap
+{
+  typedef hamtmap<Key, T>     Self;
+
+public:
+  typedef Key                key_type;
+  typedef T                  data_type;
+  typedef T                  mapped_type;
+  typedef pair<const Key, T> value_type;
+  typedef unsigned int       size_type;
+  typedef int                difference_type;
+
+private:
+  // bits of the hash used at each level, and the number of
+  // hash bits. below that depth all keys in a node have the
+  // same hash, and they're kept in a plain list.
+  enum { bits = 5, branches = 1 << bits, hash_bits = 32,
+	 max_depth = (hash_bits + bits - 1) / bits + 1 };
+
+  /**
+   * \class Leaf.
+   * \brief An entry of the map, shared by all copies holding it.
+   */
+  struct Leaf {
+    // build the entry in place from args.
+    template <class... Args>
+    Leaf(size_type h, Args&&... args):
+      value_m(std::forward<Args>(args)...), hash_m(h), refs(1) {}
+    value_type value_m;
+    // hash of the key, computed once on insertion.
+    size_type hash_m;
+    int refs;
+  };
+
+  /**
+   * \class Node.
+   * \brief A node of the trie. Bit i of datamap is set if branch i holds
+   * a single entry, bit i of nodemap if it holds a subtrie. The entries
+   * and subtries are stored in the order of their branches. In a node
+   * below the last level the bitmaps are unused, and all its entries
+   * have the same hash.
+   */
+  struct Node {
+    Node(size_type my_nleaves, size_type my_nchildren):
+      datamap(0), nodemap(0), nleaves(my_nleaves), nchildren(my_nchildren), refs(1),
+      leaves(my_nleaves ? new Leaf*[my_nleaves] : NULL),
+      children(my_nchildren ? new Node*[my_nchildren] : NULL) {}
+    ~Node() {
+      delete [] leaves;
+      delete [] children;
+    }
+    unsigned int datamap, nodemap;
+    size_type nleaves, nchildren;
+    int refs;
+    Leaf** leaves;
+    Node** children;
+  };
+
+public:
+
+  /**
+   * \class _iterator.
+   * \brief Iterator over the entries of the trie, depth first.
+   * It keeps the path from the root to the current entry.
+   */
+  class _iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef const pair<const Key, T>  value_type;
+    typedef int                       difference_type;
+    typedef value_type*               pointer;
+    typedef value_type&               reference;
+
+    friend class hamtmap;
+
+    _iterator(): depth_m(-1), leaf_m(NULL) {}
+
+    bool operator==(const _iterator& x) const {
+      return (leaf_m == x.leaf_m);
+    }
+
+    bool operator!=(const _iterator& x) const {
+      return (leaf_m != x.leaf_m);
+    }
+
+    reference operator*() const {
+      return leaf_m->value_m;
+    }
+
+    pointer operator->() const {
+      return &(leaf_m->value_m);
+    }
+
+    _iterator& operator++() {
+      _advance();
+      return *this;
+    }
+
+    _iterator operator++(int) {
+      _iterator ret(*this);
+      _advance();
+      return ret;
+    }
+
+  private:
+    // start at the first entry under root.
+    _iterator(const Node* root): depth_m(-1), leaf_m(NULL) {
+      if (root != NULL) {
+	depth_m = 0;
+	path_m[0] = root;
+	pos_m[0] = 0;
+	_advance();
+      }
+    }
+
+    // point at leaf, the entry for key x with hash h under root.
+    _iterator(const Node* root, string_view x, size_type h): depth_m(0), leaf_m(NULL) {
+      const Node* n = root;
+      size_type shift = 0;
+      while (true) {
+	path_m[depth_m] = n;
+	size_type i;
+	if (shift >= hash_bits) {
+	  for (i=0; n->leaves[i]->value_m.first != x; ++i) {}
+	}
+	else {
+	  unsigned int bit = _bit(h, shift);
+	  if (n->nodemap & bit) {
+	    // the subtrie is visited after the entries of n.
+	    size_type c = _index(n->nodemap, bit);
+	    pos_m[depth_m++] = n->nleaves + c + 1;
+	    n = n->children[c];
+	    shift += bits;
+	    continue;
+	  }
+	  i = _index(n->datamap, bit);
+	}
+	pos_m[depth_m] = i + 1;
+	leaf_m = n->leaves[i];
+	return;
+      }
+    }
+
+    // move to the next entry: the entries of a node come
+    // first, then the entries of its subtries.
+    void _advance() {
+      while (depth_m >= 0) {
+	const Node* n = path_m[depth_m];
+	size_type i = pos_m[depth_m]++;
+	if (i < n->nleaves) {
+	  leaf_m = n->leaves[i];
+	  return;
+	}
+	else if (i < n->nleaves + n->nchildren) {
+	  ++depth_m;
+	  path_m[depth_m] = n->children[i - n->nleaves];
+	  pos_m[depth_m] = 0;
+	}
+	else {
+	  --depth_m;
+	}
+      }
+      leaf_m = NULL;
+    }
+
+    const Node* path_m[max_depth + 1];
+    // the next leaf or subtrie to visit at each depth.
+    size_type pos_m[max_depth + 1];
+    int depth_m;
+    Leaf* leaf_m;
+  };
+
+  typedef _iterator iterator;
+  typedef _iterator const_iterator;
+
+public:
+  // default constructor to create an empty map
+  hamtmap(): root_m(NULL), size_m(0), inserts_m(0), finds_m(0), misses_m(0) {}
+
+  // copy constructor, shares all nodes with x.
+  hamtmap(const Self& x):
+    root_m(x.root_m), size_m(x.size_m), inserts_m(0), finds_m(0), misses_m(0)
+  {
+    if (root_m != NULL) ++root_m->refs;
+  }
+
+  // destructor.
+  ~hamtmap() {
+    _release(root_m);
+  }
+
+  // assignment, shares all nodes with x.
+  Self& operator=(const Self& x) {
+    if (x.root_m != NULL) ++x.root_m->refs;
+    _release(root_m);
+    root_m = x.root_m;
+    size_m = x.size_m;
+    return *this;
+  }
+
+  // a copy of the map as it is now, which later
+  // changes to either of them don't affect.
+  Self snapshot() const {
+    return *this;
+  }
+
+  // accessors:
+  const_iterator begin() const {
+    return const_iterator(root_m);
+  }
+  const_iterator end() const {
+    return const_iterator();
+  }
+  bool empty() const {
+    return size_m == 0;
+  }
+  size_type size() const {
+    return size_m;
+  }
+  // number of nodes in the trie.
+  size_type bucket_count() const {
+    return _count_nodes(root_m);
+  }
+  // entries per node.
+  float load_factor() const {
+    return root_m ? static_cast<float>(size_m) / bucket_count() : 0;
+  }
+
+  // the chain length and probe length histograms and the
+  // operation counters of the map. each node counts as a
+  // bucket holding its own entries, and an entry is found
+  // by visiting the nodes from the root down to it.
+  map_stats stats() const {
+    map_stats s;
+    s.size = size_m;
+    s.bucket_count = bucket_count();
+    s.load_factor = load_factor();
+    s.inserts = inserts_m;
+    s.finds = finds_m;
+    s.misses = misses_m;
+    _node_stats(root_m, 1, s);
+    summarize_probes(s);
+    return s;
+  }
+
+  // insert/erase
+  pair<iterator,bool> insert(const value_type& x) {
+    return _emplace_key(x.first, x);
+  }
+
+  // insert key k with the value built from args, if k's not
+  // in the map yet. nothing is built or moved otherwise.
+  template <class... Args>
+  pair<iterator,bool> try_emplace(const Key& k, Args&&... args) {
+    return _emplace_key(k, piecewise_construct, forward_as_tuple(k),
+			forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template <class... Args>
+  pair<iterator,bool> try_emplace(Key&& k, Args&&... args) {
+    return _emplace_key(k, piecewise_construct, forward_as_tuple(std::move(k)),
+			forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  void erase(iterator pos) {
+    if (pos.leaf_m != NULL) erase(pos->first);
+  }
+
+  size_type erase(const Key& x) {
+    size_type h = _hash_func(x);
+    if (_find(x, h) == NULL) {
+      // the key's not found.
+      return 0;
+    }
+    _erase(root_m, x, h, 0);
+    if (--size_m == 0) {
+      _release(root_m);
+      root_m = NULL;
+    }
+    return 1;
+  }
+
+  void clear() {
+    _release(root_m);
+    root_m = NULL;
+    size_m = 0;
+  }
+
+  // map operations:
+  const_iterator find(const Key& x) const {
+    return find(string_view(x));
+  }
+
+  // look up by a view of the key, no string is made.
+  const_iterator find(string_view x) const {
+    size_type h = _hash_func(x);
+    if (_find(x, h) == NULL) {
+      return end();
+    }
+    return const_iterator(root_m, x, h);
+  }
+
+  const_iterator find(const char* x) const {
+    return find(string_view(x));
+  }
+
+  size_type count(const Key& x) const {
+    return count(string_view(x));
+  }
+
+  size_type count(string_view x) const {
+    if (_find(x, _hash_func(x)) != NULL) {
+      return 1;
+    }
+    else {
+      return 0;
+    }
+  }
+
+  size_type count(const char* x) const {
+    return count(string_view(x));
+  }
+
+  // the value bound to x, NULL if there's none.
+  const T* get(string_view x) const {
+    Leaf* leaf = _find(x, _hash_func(x));
+    return leaf ? &leaf->value_m.second : NULL;
+  }
+
+  T& operator[](const Key& k) {
+    size_type h = _hash_func(k);
+    if (_find(k, h) == NULL) {
+      // if the key's not found, insert
+      // it with default init value.
+      if (root_m == NULL) root_m = new Node(0, 0);
+      ++size_m;
+      ++inserts_m;
+      return _insert(root_m, new Leaf(h, k, T()), 0)->value_m.second;
+    }
+    // the entry may be shared, so copy
+    // it before handing out a reference.
+    return _own_leaf(root_m, k, h, 0)->value_m.second;
+  }
+
+private:
+  // hash function. currently only work for string.
+  static size_type _hash_func(string_view key) {
+    return hash_string(key.data(), key.size());
+  }
+
+  // insert the entry built from args, whose key is
+  // k, if k's not in the map yet.
+  template <class... Args>
+  pair<iterator,bool> _emplace_key(string_view k, Args&&... args) {
+    size_type h = _hash_func(k);
+    if (_find(k, h) != NULL) {
+      // the key's already in the map.
+      return pair<iterator, bool>(iterator(root_m, k, h), false);
+    }
+    if (root_m == NULL) {
+      root_m = new Node(0, 0);
+    }
+    Leaf* leaf = _insert(root_m, new Leaf(h, std::forward<Args>(args)...), 0);
+    ++size_m;
+    ++inserts_m;
+    return pair<iterator, bool>(iterator(root_m, leaf->value_m.first, h), true);
+  }
+
+  // the branch of hash h at the level starting at bit shift.
+  static unsigned int _bit(size_type h, size_type shift) {
+    return 1u << ((h >> shift) & (branches - 1));
+  }
+
+  // the index of the entry or subtrie at bit in map.
+  static size_type _index(unsigned int map, unsigned int bit) {
+    return __builtin_popcount(map & (bit - 1));
+  }
+
+  // find the entry for key x with hash h, NULL if not found.
+  Leaf* _find(string_view x, size_type h) const {
+    ++finds_m;
+    const Node* n = root_m;
+    size_type shift = 0;
+    while (n != NULL) {
+      if (shift >= hash_bits) {
+	for (size_type i=0; i<n->nleaves; ++i) {
+	  if (n->leaves[i]->value_m.first == x) return n->leaves[i];
+	}
+	break;
+      }
+      unsigned int bit = _bit(h, shift);
+      if (n->datamap & bit) {
+	Leaf* leaf = n->leaves[_index(n->datamap, bit)];
+	if (leaf->hash_m == h && leaf->value_m.first == x) return leaf;
+	break;
+      }
+      if (!(n->nodemap & bit)) {
+	break;
+      }
+      n = n->children[_index(n->nodemap, bit)];
+      shift += bits;
+    }
+    ++misses_m;
+    return NULL;
+  }
+
+  static size_type _count_nodes(const Node* n) {
+    if (n == NULL) return 0;
+    size_type count = 1;
+    for (size_type i=0; i<n->nchildren; ++i) {
+      count += _count_nodes(n->children[i]);
+    }
+    return count;
+  }
+
+  // add the nodes of the subtrie n, at the given depth, to s.
+  static void _node_stats(const Node* n, size_type depth, map_stats& s) {
+    if (n == NULL) return;
+    add_to_histogram(s.chain_lengths, n->nleaves);
+    for (size_type i=0; i<n->nleaves; ++i) {
+      add_to_histogram(s.probe_lengths, depth);
+    }
+    for (size_type i=0; i<n->nchildren; ++i) {
+      _node_stats(n->children[i], depth + 1, s);
+    }
+  }
+
+  // a copy of n sharing its entries and subtries.
+  static Node* _copy_node(const Node* n, size_type nleaves, size_type nchildren) {
+    Node* copy = new Node(nleaves, nchildren);
+    copy->datamap = n->datamap;
+    copy->nodemap = n->nodemap;
+    return copy;
+  }
+
+  // make sure the node in slot n is used by this map only,
+  // replacing it with a copy if it's shared.
+  static Node* _own(Node*& n) {
+    if (n->refs == 1) return n;
+    Node* copy = _copy_node(n, n->nleaves, n->nchildren);
+    for (size_type i=0; i<n->nleaves; ++i) {
+      copy->leaves[i] = n->leaves[i];
+      ++copy->leaves[i]->refs;
+    }
+    for (size_type i=0; i<n->nchildren; ++i) {
+      copy->children[i] = n->children[i];
+      ++copy->children[i]->refs;
+    }
+    --n->refs;
+    n = copy;
+    return copy;
+  }
+
+  // add leaf at index i of n's entries, n is replaced by
+  // a node one entry larger. n is owned by this map.
+  static void _add_leaf(Node*& n, size_type i, Leaf* leaf) {
+    Node* grown = _copy_node(n, n->nleaves + 1, n->nchildren);
+    for (size_type j=0; j<i; ++j) grown->leaves[j] = n->leaves[j];
+    grown->leaves[i] = leaf;
+    for (size_type j=i; j<n->nleaves; ++j) grown->leaves[j + 1] = n->leaves[j];
+    for (size_type j=0; j<n->nchildren; ++j) grown->children[j] = n->children[j];
+    delete n;
+    n = grown;
+  }
+
+  // remove the entry at index i of n, which is
+  // owned by this map. the leaf isn't released.
+  static void _remove_leaf(Node*& n, size_type i) {
+    Node* shrunk = _copy_node(n, n->nleaves - 1, n->nchildren);
+    for (size_type j=0; j<i; ++j) shrunk->leaves[j] = n->leaves[j];
+    for (size_type j=i+1; j<n->nleaves; ++j) shrunk->leaves[j - 1] = n->leaves[j];
+    for (size_type j=0; j<n->nchildren; ++j) shrunk->children[j] = n->children[j];
+    delete n;
+    n = shrunk;
+  }
+
+  // in n, owned by this map, turn the entry at bit
+  // into the subtrie child, or the other way round.
+  static void _leaf_to_child(Node*& n, unsigned int bit, Node* child) {
+    size_type i = _index(n->datamap, bit);
+    size_type c = _index(n->nodemap, bit);
+    Node* changed = _copy_node(n, n->nleaves - 1, n->nchildren + 1);
+    changed->datamap ^= bit;
+    changed->nodemap |= bit;
+    for (size_type j=0; j<i; ++j) changed->leaves[j] = n->leaves[j];
+    for (size_type j=i+1; j<n->nleaves; ++j) changed->leaves[j - 1] = n->leaves[j];
+    for (size_type j=0; j<c; ++j) changed->children[j] = n->children[j];
+    changed->children[c] = child;
+    for (size_type j=c; j<n->nchildren; ++j) changed->children[j + 1] = n->children[j];
+    delete n;
+    n = changed;
+  }
+
+  static void _child_to_leaf(Node*& n, unsigned int bit, Leaf* leaf) {
+    size_type i = _index(n->datamap, bit);
+    size_type c = _index(n->nodemap, bit);
+    Node* changed = _copy_node(n, n->nleaves + 1, n->nchildren - 1);
+    changed->datamap |= bit;
+    changed->nodemap ^= bit;
+    for (size_type j=0; j<i; ++j) changed->leaves[j] = n->leaves[j];
+    changed->leaves[i] = leaf;
+    for (size_type j=i; j<n->nleaves; ++j) changed->leaves[j + 1] = n->leaves[j];
+    for (size_type j=0; j<c; ++j) changed->children[j] = n->children[j];
+    for (size_type j=c+1; j<n->nchildren; ++j) changed->children[j - 1] = n->children[j];
+    delete n;
+    n = changed;
+  }
+
+  // a subtrie holding the two leaves a and b,
+  // starting at the level of shift.
+  static Node* _merge(Leaf* a, Leaf* b, size_type shift) {
+    if (shift >= hash_bits) {
+      Node* n = new Node(2, 0);
+      n->leaves[0] = a;
+      n->leaves[1] = b;
+      return n;
+    }
+    unsigned int bit_a = _bit(a->hash_m, shift);
+    unsigned int bit_b = _bit(b->hash_m, shift);
+    if (bit_a == bit_b) {
+      Node* n = new Node(0, 1);
+      n->nodemap = bit_a;
+      n->children[0] = _merge(a, b, shift + bits);
+      return n;
+    }
+    Node* n = new Node(2, 0);
+    n->datamap = bit_a | bit_b;
+    n->leaves[bit_a < bit_b ? 0 : 1] = a;
+    n->leaves[bit_a < bit_b ? 1 : 0] = b;
+    return n;
+  }
+
+  // insert leaf, whose key is not in the map, into the
+  // subtrie in slot n at the level of shift. return leaf.
+  static Leaf* _insert(Node*& n, Leaf* leaf, size_type shift) {
+    _own(n);
+    if (shift >= hash_bits) {
+      _add_leaf(n, n->nleaves, leaf);
+      return leaf;
+    }
+    unsigned int bit = _bit(leaf->hash_m, shift);
+    if (n->datamap & bit) {
+      // the branch holds another entry, push
+      // both of them down into a new subtrie.
+      Leaf* other = n->leaves[_index(n->datamap, bit)];
+      _leaf_to_child(n, bit, _merge(other, leaf, shift + bits));
+    }
+    else if (n->nodemap & bit) {
+      _insert(n->children[_index(n->nodemap, bit)], leaf, shift + bits);
+    }
+    else {
+      _add_leaf(n, _index(n->datamap, bit), leaf);
+      n->datamap |= bit;
+    }
+    return leaf;
+  }
+
+  // erase key x with hash h, which is in the subtrie
+  // in slot n at the level of shift.
+  static void _erase(Node*& n, const Key& x, size_type h, size_type shift) {
+    _own(n);
+    if (shift >= hash_bits) {
+      for (size_type i=0; i<n->nleaves; ++i) {
+	if (n->leaves[i]->value_m.first == x) {
+	  _release(n->leaves[i]);
+	  _remove_leaf(n, i);
+	  return;
+	}
+      }
+      return;
+    }
+    unsigned int bit = _bit(h, shift);
+    if (n->datamap & bit) {
+      size_type i = _index(n->datamap, bit);
+      _release(n->leaves[i]);
+      _remove_leaf(n, i);
+      n->datamap ^= bit;
+      return;
+    }
+    Node*& child = n->children[_index(n->nodemap, bit)];
+    _erase(child, x, h, shift + bits);
+    // a subtrie left with one entry is
+    // replaced by the entry itself.
+    if (child->nleaves == 1 && child->nchildren == 0) {
+      Leaf* leaf = child->leaves[0];
+      delete child;
+      _child_to_leaf(n, bit, leaf);
+    }
+  }
+
+  // the entry for key x with hash h, which is in the subtrie in
+  // slot n at the level of shift, copied if it's shared.
+  static Leaf* _own_leaf(Node*& n, const Key& x, size_type h, size_type shift) {
+    _own(n);
+    Leaf** slot = NULL;
+    if (shift >= hash_bits) {
+      for (size_type i=0; i<n->nleaves; ++i) {
+	if (n->leaves[i]->value_m.first == x) slot = &n->leaves[i];
+      }
+    }
+    else {
+      unsigned int bit = _bit(h, shift);
+      if (n->nodemap & bit) {
+	return _own_leaf(n->children[_index(n->nodemap, bit)], x, h, shift + bits);
+      }
+      slot = &n->leaves[_index(n->datamap, bit)];
+    }
+    if ((*slot)->refs > 1) {
+      --(*slot)->refs;
+      *slot = new Leaf(h, (*slot)->value_m);
+    }
+    return *slot;
+  }
+
+  static void _release(Leaf* leaf) {
+    if (--leaf->refs == 0) delete leaf;
+  }
+
+  static void _release(Node* n) {
+    if (n == NULL || --n->refs > 0) return;
+    for (size_type i=0; i<n->nleaves; ++i) {
+      _release(n->leaves[i]);
+    }
+    for (size_type i=0; i<n->nchildren; ++i) {
+      _release(n->children[i]);
+    }
+    delete n;
+  }
+
+  Node* root_m;
+  size_type size_m;
+  // counters for stats(), lookups are
+  // counted from const members too.
+  size_type inserts_m;
+  mutable size_type finds_m, misses_m;
+};
+
+#endif // HAMTMAP_HPP
@@ -1,10 +1,40 @@
+/**
+ * \file hashtablemap.hpp
+ *
+ * A map implemented as a hash table with separate chaining.
+ * Keys are strings. Each node keeps the hash of its key, and
+ * chains are sorted by hash first, so most comparisons along
+ * a chain are between two ints. Entries are built in their node
+ * (emplace, try_emplace), keys can be looked up as a string_view
+ * or const char* without making a string, and a rehash relinks
+ * the nodes instead of copying them.
+ *
+ * Nodes come from a pool kept by each map: they are carved out of
+ * chunks taken from the map's allocator, and erased nodes are reused.
+ * Destroying or clearing the map hands back whole chunks, not nodes.
+ * With pmr_hashtablemap, the chunks come from a std::pmr memory
+ * resource, such as an arena shared by many maps.
+ */
+
+#ifndef HASHTABLEMAP_HPP
+#define HASHTABLEMAP_HPP
+
 #include <cstring>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include "mapstats.hpp"
+#include "strhash.hpp"
 using namespace std;
 
-template <class Key, class T>
+template <class Key, class T, class Alloc = std::allocator<pair<const Key, T> > >
 class hashtablemap
 {
-  typedef hashtablemap<Key, T>     Self;
+  typedef hashtablemap<Key, T, Alloc>     Self;
 
 public:
   typedef Key                key_type;
@@ -13,6 +43,7 @@ public:
   typedef pair<const Key, T> value_type;
   typedef unsigned int       size_type;
   typedef int                difference_type;
+  typedef Alloc              allocator_type;
 
 public:
   /**
@@ -20,74 +51,46 @@ public:
    * \brief A node for linked list.
    */
   struct Node {
-    Node(value_type data, Node* next=NULL):
-      value_m(data), next_m(next) {}
+    // build the entry in place from args.
+    template <class... Args>
+    Node(size_type hash, Args&&... args):
+      value_m(std::forward<Args>(args)...), hash_m(hash), next_m(NULL) {}
     Node(const Node& x):
-      value_m(x.value_m), next_m(x.next_m) {}
+      value_m(x.value_m), hash_m(x.hash_m), next_m(x.next_m) {}
     ~Node() {}
     Node& operator=(const Node& x) {
       value_m = x.value_m;
+      hash_m = x.hash_m;
       next_m = x.next_m;
       return *this;
     }
+    // ordering of the node against key k with hash h,
+    // negative if the node goes before it.
+    int compare(size_type h, string_view k) const {
+      if (hash_m != h) return (hash_m < h) ? -1 : 1;
+      return string_view(value_m.first).compare(k);
+    }
     value_type value_m;
+    // hash of the key, computed once on insertion.
+    size_type hash_m;
     Node* next_m;
   };
   /**
    * \class LinkedList.
    * \brief A listed list for separate chaining
-   * in the hash table.
+   * in the hash table. The nodes belong to the
+   * map's pool, the list only links them.
    */
   class LinkedList {
   public:
     LinkedList(): head_m(NULL) {}
-    LinkedList(const LinkedList& x):
-      head_m(NULL)
-    {
-      Node* node_it = x.head_m;
-      Node* new_node = head_m;
-      while (node_it != NULL) {	
-	new_node = insert(new_node, node_it->value_m);
-	node_it = node_it->next_m;	
-      }
-    }
-
-    ~LinkedList() {
-      _delete_all_nodes(head_m);
-    }
-
-    // delete all nodes from x to the end.
-    void _delete_all_nodes(Node* x) {
-      if (x == NULL) {
-	return;
-      }
-      else {
-	_delete_all_nodes(x->next_m);
-	delete x;
-	return;
-      }
-    }
-
-    LinkedList& operator=(const LinkedList& x) {
-      if (this != &x) {
-	_delete_all_nodes(head_m);
-	head_m = NULL;
-	Node* new_node = head_m;
-	Node* node_it = x.head_m;
-	while (node_it != NULL) {
-	  new_node = insert(new_node, node_it->value_m);
-	  node_it = node_it->next_m;
-	}
-      }
-      return *this;
-    }
 
-    void erase(Node* pos) {
+    // take pos out of the list, without freeing it.
+    void unlink(Node* pos) {
       Node* node_it = head_m;
       // if the head's gonna be erased.
       if (pos == head_m) {
 	head_m = head_m->next_m;
-	delete node_it;
 	return;
       }
       // find the previous node of pos.
@@ -97,36 +100,33 @@ public:
       // if node_it is not NULL.
       if (node_it) {
 	node_it->next_m = pos->next_m;
-	delete pos;
-	return;
       }
-      return;
     }
 
     bool empty() {
       return head_m == NULL;
     }
     
-    // try to find key k, if found return that node,
-    // else return the pos where it should be.
-    pair<Node*, bool> find_key(const key_type& k) {
+    // try to find key k with hash h, if found return that 
+    // node, else return the pos where it should be.
+    pair<Node*, bool> find_key(string_view k, size_type h) {
       // if k is less then head's key,
       // then return pos as NULL.
-
-      if (head_m == NULL || k < head_m->value_m.first) {
+      int cmp;
+      if (head_m == NULL || (cmp = head_m->compare(h, k)) > 0) {
 	return pair<Node*, bool>(NULL, false);
       }
       // found in the head.
-      else if (k == head_m->value_m.first) {
+      else if (cmp == 0) {
 	return pair<Node*, bool>(head_m, true);
       }
       Node* curr = head_m;
       Node* next = head_m->next_m;
-      while (next != NULL && next->value_m.first < k) {
+      while (next != NULL && (cmp = next->compare(h, k)) < 0) {
 	curr = next;
 	next = next->next_m;
       }
-      if (next && next->value_m.first == k) {
+      if (next && cmp == 0) {
 	return pair<Node*, bool>(next, true);
       }
       else {
@@ -134,19 +134,19 @@ public:
       }
     }
     
-    // insert data after pos in the list. 
+    // link new_node into the list after pos.
     // return the new node.
-    Node* insert(Node* pos, value_type data) {
+    Node* link(Node* pos, Node* new_node) {
       // insert before head.
       if (pos == NULL) {
-	head_m = new Node(data, head_m);
-	return head_m;
+	new_node->next_m = head_m;
+	head_m = new_node;
       }
       else {
-	Node* new_node = new Node(data, pos->next_m);
+	new_node->next_m = pos->next_m;
 	pos->next_m = new_node;
-	return new_node;
       }
+      return new_node;
     }
     
     Node* head_m;
@@ -199,7 +199,7 @@ public:
 
     // post ++, use sort of hack method,
     // pass a dummy int argument.
-    iterator& operator++(int) {
+    iterator operator++(int) {
       iterator ret(*this);
       node_m = map_m->_successor(node_m);
       return ret;
@@ -255,7 +255,7 @@ public:
 
     // post ++, use sort of hack method,
     // pass a dummy int argument.
-    const_iterator& operator++(int) {
+    const_iterator operator++(int) {
       const_iterator ret(*this);
       node_m = map_m->_successor(node_m);
       return ret;
@@ -271,43 +271,68 @@ public:
 
 public:
   // default constructor to create an empty map
-  hashtablemap(size_type m=503): 
-    table_size(m), size_m(0)
+  hashtablemap(size_type m=default_buckets, const Alloc& alloc=Alloc()): 
+    alloc_m(alloc), table_m(NULL), table_size(0), size_m(0),
+    inserts_m(0), finds_m(0), misses_m(0)
+  {
+    _allocate_table(m);
+  }
+
+  // an empty map drawing its memory from alloc.
+  explicit hashtablemap(const Alloc& alloc):
+    alloc_m(alloc), table_m(NULL), table_size(0), size_m(0),
+    inserts_m(0), finds_m(0), misses_m(0)
   {
-    table_m = new LinkedList[table_size];
+    _allocate_table(default_buckets);
   }
 
   // overload copy constructor to do a deep copy
   hashtablemap(const Self& x): 
-    table_size(x.table_size), size_m(x.size_m)
+    alloc_m(allocator_traits<Alloc>::select_on_container_copy_construction(x.alloc_m)),
+    table_m(NULL), table_size(0), size_m(0),
+    inserts_m(0), finds_m(0), misses_m(0)
   {
-    table_m = new LinkedList[table_size];
-    // copy all elements from x.
-    for (size_type i=0; i!=table_size; ++i) {
-      table_m[i] = x.table_m[i];
-    }
+    _copy_from(x);
+  }
+
+  // move constructor, x is left empty
+  // and without buckets.
+  hashtablemap(Self&& x) noexcept:
+    alloc_m(std::move(x.alloc_m)), table_m(NULL), table_size(0), size_m(0),
+    inserts_m(0), finds_m(0), misses_m(0)
+  {
+    _steal(x);
   }
 
   // destructor.
   ~hashtablemap() {
-    delete [] table_m;
+    _destroy();
   }
 
   // overload assignment to do a deep copy
   Self& operator=(const Self& x) {
     // self assignment protection.
     if (this != &x) {
-      delete [] table_m;
-      table_size = x.table_size;
-      size_m = x.size_m;
-      table_m = new LinkedList[table_size];
-      for (size_type i=0; i!=table_size; ++i) {
-	table_m[i] = x.table_m[i];
-      }
+      _destroy();
+      _copy_from(x);
     }
     return *this;
   }
 
+  // move assignment, x is left empty and without buckets.
+  // if the allocators differ, the entries are copied.
+  Self& operator=(Self&& x) {
+    if (this != &x) {
+      _destroy();
+      _move_assign(x, typename allocator_traits<Alloc>::propagate_on_container_move_assignment());
+    }
+    return *this;
+  }
+
+  allocator_type get_allocator() const {
+    return alloc_m;
+  }
+
   // accessors:
   iterator begin() {
     return iterator(this, _get_first_elem());
@@ -330,27 +355,48 @@ public:
 
   // insert/erase
   pair<iterator,bool> insert(const value_type& x) {
-    // first try to find the key.
-    size_type i = _hash_func(x.first);
-    pair<Node*, bool> ret = _find(x.first, i);
+    return _emplace_key(x.first, x);
+  }
+
+  // insert from a pair whose key can be moved,
+  // such as pair<string, T>.
+  template <class P>
+  pair<iterator,bool> insert(P&& x) {
+    return _emplace_key(x.first, std::forward<P>(x));
+  }
+
+  // build an entry from args, and keep
+  // it if its key's not in the map yet.
+  template <class... Args>
+  pair<iterator,bool> emplace(Args&&... args) {
+    Node* new_node = _new_node(0, std::forward<Args>(args)...);
+    new_node->hash_m = _hash_func(new_node->value_m.first);
+    pair<Node*, bool> ret = _find(new_node->value_m.first, new_node->hash_m);
     if (ret.second) {
-      // the key's already in the map.
+      _free_node(new_node);
       return pair<iterator, bool>(iterator(this, ret.first), false);
     }
-    else {
-      // else insert x in table_m[i] bucket.
-      ++size_m;
-      Node* new_node = table_m[i].insert(ret.first, x);
-      return pair<iterator, bool>(iterator(this, new_node), true);
-    }
+    return pair<iterator, bool>(iterator(this, _link(ret.first, new_node)), true);
+  }
+
+  // insert key k with the value built from args, if k's not
+  // in the map yet. nothing is built or moved otherwise.
+  template <class... Args>
+  pair<iterator,bool> try_emplace(const Key& k, Args&&... args) {
+    return _emplace_key(k, piecewise_construct, forward_as_tuple(k), 
+			forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template <class... Args>
+  pair<iterator,bool> try_emplace(Key&& k, Args&&... args) {
+    return _emplace_key(k, piecewise_construct, forward_as_tuple(std::move(k)), 
+			forward_as_tuple(std::forward<Args>(args)...));
   }
 
   void erase(iterator pos) {
-    key_type k = pos->first;
-    size_type i = _hash_func(k);
-    pair<Node*, bool> ret = _find(k, i);
-    if (ret.second) {
-      table_m[i].erase(ret.first);
+    if (pos.node_m != NULL) {
+      table_m[pos.node_m->hash_m % table_size].unlink(pos.node_m);
+      _free_node(pos.node_m);
       --size_m;
     }
   }
@@ -371,15 +417,104 @@ public:
   }
   
   void clear() {
-    delete [] table_m;
-    table_m = new LinkedList(table_size);
+    _destroy_nodes();
+    for (size_type i=0; i<table_size; ++i) {
+      table_m[i].head_m = NULL;
+    }
     size_m = 0;
   }
 
+  // move the entries into a table with m buckets,
+  // relinking the nodes without copying them.
+  void rehash(size_type m) {
+    if (m == 0) m = 1;
+    LinkedList* old_table = table_m;
+    size_type old_size = table_size;
+    _allocate_table(m);
+    for (size_type i=0; i<old_size; ++i) {
+      Node* node = old_table[i].head_m;
+      while (node != NULL) {
+	Node* next = node->next_m;
+	LinkedList& bucket = table_m[node->hash_m % table_size];
+	bucket.link(bucket.find_key(node->value_m.first, node->hash_m).first, node);
+	node = next;
+      }
+      old_table[i].head_m = NULL;
+    }
+    _free_table(old_table, old_size);
+  }
+
+  // make sure there is a bucket for each of m entries.
+  void reserve(size_type m) {
+    if (m > table_size) rehash(m);
+  }
+
+  // the hash value of key k, which can be
+  // computed once and passed to find and count.
+  static size_type hash(string_view k) {
+    return _hash_func(k);
+  }
+
+  // number of buckets in the table.
+  size_type bucket_count() const {
+    return table_size;
+  }
+  float load_factor() const {
+    return table_size ? static_cast<float>(size_m) / table_size : 0;
+  }
+
+  // the chain length and probe length histograms
+  // and the operation counters of the table.
+  map_stats stats() const {
+    map_stats s;
+    s.size = size_m;
+    s.bucket_count = table_size;
+    s.load_factor = load_factor();
+    s.inserts = inserts_m;
+    s.finds = finds_m;
+    s.misses = misses_m;
+    for (size_type i=0; i<table_size; ++i) {
+      // the k-th node of a chain is found
+      // after comparing k nodes.
+      size_type length = 0;
+      for (Node* node=table_m[i].head_m; node!=NULL; node=node->next_m) {
+	add_to_histogram(s.probe_lengths, ++length);
+      }
+      add_to_histogram(s.chain_lengths, length);
+    }
+    summarize_probes(s);
+    return s;
+  }
+
   // map operations:
   iterator find(const Key& x) {
-    size_type i = _hash_func(x);
-    pair<Node*, bool> ret = _find(x, i);
+    return find(string_view(x), _hash_func(x));
+  }
+  
+  const_iterator find(const Key& x) const {
+    return find(string_view(x), _hash_func(x));
+  }
+
+  // look up by a view of the key, no string is made.
+  iterator find(string_view x) {
+    return find(x, _hash_func(x));
+  }
+
+  const_iterator find(string_view x) const {
+    return find(x, _hash_func(x));
+  }
+
+  iterator find(const char* x) {
+    return find(string_view(x));
+  }
+
+  const_iterator find(const char* x) const {
+    return find(string_view(x));
+  }
+
+  // look up by the key and its hash value h.
+  iterator find(string_view x, size_type h) {
+    pair<Node*, bool> ret = _find(x, h);
     if (ret.second) {
       return iterator(this, ret.first);
     }
@@ -388,9 +523,8 @@ public:
     }
   }
   
-  const_iterator find(const Key& x) const {
-    size_type i =_hash_func(x);
-    pair<Node*, bool> ret = _find(x, i);
+  const_iterator find(string_view x, size_type h) const {
+    pair<Node*, bool> ret = _find(x, h);
     if (ret.second) {
       return const_iterator(this, ret.first);
     }
@@ -400,7 +534,19 @@ public:
   }
 
   size_type count(const Key& x) const {
-    if (find(x) != end()) {
+    return count(string_view(x), _hash_func(x));
+  }
+
+  size_type count(string_view x) const {
+    return count(x, _hash_func(x));
+  }
+
+  size_type count(const char* x) const {
+    return count(string_view(x));
+  }
+
+  size_type count(string_view x, size_type h) const {
+    if (_find(x, h).second) {
       return 1;
     }
     else {
@@ -408,39 +554,62 @@ public:
     }
   }
   
+  // if the key's not found, insert
+  // it with default init value.
   T& operator[](const Key& k) {
-    // first try to find the key.
-    iterator it = find(k);
-    if (it != end()) {
-      return it->second;
-    }
-    // if the key's not found,
-    // insert it with default
-    // init value;
-    else {
-      value_type x(k, T());
-      pair<iterator, bool> ret = insert(x);
-      return ret.first->second;
-    }
+    return try_emplace(k).first->second;
+  }
+
+  T& operator[](Key&& k) {
+    return try_emplace(std::move(k)).first->second;
   }
 
 private:
+  // the number of buckets unless given.
+  static constexpr size_type default_buckets = 503;
+
+  // insert the entry built from args, whose key is
+  // k, if k's not in the map yet.
+  template <class... Args>
+  pair<iterator,bool> _emplace_key(string_view k, Args&&... args) {
+    size_type h = _hash_func(k);
+    pair<Node*, bool> ret = _find(k, h);
+    if (ret.second) {
+      // the key's already in the map.
+      return pair<iterator, bool>(iterator(this, ret.first), false);
+    }
+    Node* new_node = _new_node(h, std::forward<Args>(args)...);
+    return pair<iterator, bool>(iterator(this, _link(ret.first, new_node)), true);
+  }
+
+  // link new_node, whose key's not in the map, after pos in
+  // its bucket, pos being where _find left off looking.
+  Node* _link(Node* pos, Node* new_node) {
+    if (table_size == 0) {
+      // a moved from map gets its buckets back.
+      rehash(default_buckets);
+      pos = _find(new_node->value_m.first, new_node->hash_m).first;
+    }
+    ++size_m;
+    ++inserts_m;
+    return table_m[new_node->hash_m % table_size].link(pos, new_node);
+  }
+
   // hash function. currently only work for string.
-  size_type _hash_func(const key_type& key) const {
-    int seed = 1;
-    int sum = 0;
-    for (int i=key.length()-1; i>=0; --i) {
-      int a = key[i];
-      sum = (sum + (a*seed % table_size)) % table_size;
-      seed *= 128;
-    }
-    // cout << key << " " << sum << endl;
-    return sum;
+  static size_type _hash_func(string_view key) {
+    return hash_string(key.data(), key.size());
   } 
 
-  // find key x in the ith bucket.
-  pair<Node*, bool> _find(const Key& x, size_type i) const {
-    return table_m[i].find_key(x);
+  // find key x with hash h in its bucket.
+  pair<Node*, bool> _find(string_view x, size_type h) const {
+    ++finds_m;
+    if (table_size == 0) {
+      ++misses_m;
+      return pair<Node*, bool>(NULL, false);
+    }
+    pair<Node*, bool> ret = table_m[h % table_size].find_key(x, h);
+    if (!ret.second) ++misses_m;
+    return ret;
   }
 
   // find next elem, no need to consider
@@ -452,7 +621,7 @@ private:
     }
     // else find the next bucket that has elem.
     else if (elem && elem->next_m == NULL) {
-      size_type i = _hash_func(elem->value_m.first) + 1;
+      size_type i = elem->hash_m % table_size + 1;
       while (i < table_size && table_m[i].empty()) {++i;}
       if (i >= table_size) {
 	return NULL;
@@ -474,6 +643,171 @@ private:
     return NULL;
   }
 
+  /**
+   * the node pool. a slot holds a node, or
+   * the next free slot once it's freed. each
+   * chunk of slots starts with two slots
+   * holding the next chunk and its length.
+   */
+  union NodeSlot {
+    NodeSlot* next;
+    size_t length;
+    alignas(Node) unsigned char node[sizeof(Node)];
+  };
+  typedef typename allocator_traits<Alloc>::template rebind_alloc<NodeSlot> SlotAlloc;
+  typedef typename allocator_traits<Alloc>::template rebind_alloc<LinkedList> TableAlloc;
+  // the first chunk holds min_chunk nodes, each next one
+  // twice as many as the one before, up to max_chunk.
+  static constexpr size_type min_chunk = 8;
+  static constexpr size_type max_chunk = 512;
+
+  // a node built from args, taken from the free
+  // list, or from a new chunk if it's empty.
+  template <class... Args>
+  Node* _new_node(size_type h, Args&&... args) {
+    if (free_m == NULL) _add_chunk();
+    NodeSlot* slot = free_m;
+    free_m = slot->next;
+    try {
+      return new (slot->node) Node(h, std::forward<Args>(args)...);
+    } catch (...) {
+      slot->next = free_m;
+      free_m = slot;
+      throw;
+    }
+  }
+
+  void _free_node(Node* node) {
+    node->~Node();
+    NodeSlot* slot = reinterpret_cast<NodeSlot*>(node);
+    slot->next = free_m;
+    free_m = slot;
+  }
+
+  void _add_chunk() {
+    size_t length = chunk_length_m ? chunk_length_m : min_chunk;
+    SlotAlloc slot_alloc(alloc_m);
+    NodeSlot* chunk = allocator_traits<SlotAlloc>::allocate(slot_alloc, length + 2);
+    chunk[0].next = chunks_m;
+    chunk[1].length = length;
+    chunks_m = chunk;
+    for (size_t i=length+1; i>=2; --i) {
+      chunk[i].next = free_m;
+      free_m = &chunk[i];
+    }
+    if (length < max_chunk) chunk_length_m = length * 2;
+  }
+
+  // destroy every entry and hand all chunks back
+  // to the allocator, without freeing nodes one by one.
+  void _destroy_nodes() {
+    for (size_type i=0; i<table_size; ++i) {
+      for (Node* node=table_m[i].head_m; node!=NULL; ) {
+	Node* next = node->next_m;
+	node->~Node();
+	node = next;
+      }
+    }
+    SlotAlloc slot_alloc(alloc_m);
+    while (chunks_m != NULL) {
+      NodeSlot* next = chunks_m[0].next;
+      allocator_traits<SlotAlloc>::deallocate(slot_alloc, chunks_m, chunks_m[1].length + 2);
+      chunks_m = next;
+    }
+    free_m = NULL;
+    chunk_length_m = 0;
+  }
+
+  // allocate m empty buckets. the old ones are not freed.
+  void _allocate_table(size_type m) {
+    TableAlloc table_alloc(alloc_m);
+    table_m = allocator_traits<TableAlloc>::allocate(table_alloc, m);
+    for (size_type i=0; i<m; ++i) {
+      new (&table_m[i]) LinkedList();
+    }
+    table_size = m;
+  }
+
+  void _free_table(LinkedList* table, size_type m) {
+    if (table == NULL) return;
+    TableAlloc table_alloc(alloc_m);
+    allocator_traits<TableAlloc>::deallocate(table_alloc, table, m);
+  }
+
+  // the allocator goes along with the entries.
+  void _move_assign(Self& x, true_type) {
+    alloc_m = std::move(x.alloc_m);
+    _steal(x);
+  }
+
+  // the allocator stays, the entries are only
+  // taken over if they come from the same one.
+  void _move_assign(Self& x, false_type) {
+    if (alloc_m == x.alloc_m) {
+      _steal(x);
+    }
+    else {
+      _copy_from(x);
+      x._destroy();
+    }
+  }
+
+  void _destroy() {
+    _destroy_nodes();
+    _free_table(table_m, table_size);
+    table_m = NULL;
+    table_size = 0;
+    size_m = 0;
+  }
+
+  // copy the entries of x, in the same buckets and
+  // order, into this map, which has no buckets.
+  void _copy_from(const Self& x) {
+    _allocate_table(x.table_size);
+    for (size_type i=0; i<table_size; ++i) {
+      Node* last = NULL;
+      for (Node* node=x.table_m[i].head_m; node!=NULL; node=node->next_m) {
+	last = table_m[i].link(last, _new_node(node->hash_m, node->value_m));
+      }
+    }
+    size_m = x.size_m;
+  }
+
+  // take over the buckets and the pool of x,
+  // which is left without any.
+  void _steal(Self& x) {
+    table_m = x.table_m;
+    table_size = x.table_size;
+    size_m = x.size_m;
+    chunks_m = x.chunks_m;
+    free_m = x.free_m;
+    chunk_length_m = x.chunk_length_m;
+    x.table_m = NULL;
+    x.table_size = 0;
+    x.size_m = 0;
+    x.chunks_m = NULL;
+    x.free_m = NULL;
+    x.chunk_length_m = 0;
+  }
+
+  Alloc alloc_m;
   LinkedList* table_m;
   size_type table_size, size_m;
+  NodeSlot* chunks_m = NULL;
+  NodeSlot* free_m = NULL;
+  // the length of the next chunk, 0 before the first.
+  size_t chunk_length_m = 0;
+  // counters for stats(), lookups are
+  // counted from const members too.
+  size_type inserts_m;
+  mutable size_type finds_m, misses_m;
 };
+
+/**
+ * A hashtablemap whose buckets and node chunks come
+ * from a std::pmr memory resource given to it.
+ */
+template <class Key, class T>
+using pmr_hashtablemap = hashtablemap<Key, T, std::pmr::polymorphic_allocator<pair<const Key, T> > >;
+
+#endif // HASHTABLEMAP_HPP
@@ -10,134 +10,82 @@
 #include <stdexcept>
 #include "parse.hpp"
 #include "eval.hpp"
+#include "output.hpp"
 #include <sstream>
+#include <cstring>
 
 using namespace std;
 
 /**
- * \brief Parse and evaluate the s-expression, and print the result.
- * \param sexpr The string vaule holding the s-expression.
+ * \brief Whether an expression that fails leaves no definitions
+ * behind in the global frame, set by the --rollback option.
  */
-void parse_eval_print(string sexpr)
+bool rollback_on_error = false;
+
+/**
+ * \brief Read the next s-expression, evaluate it, and print the result.
+ * \param reader The reader of the input.
+ * \return False at the end of the input.
+ */
+bool read_eval_print(Reader& reader)
 {
+  /**
+   * the snapshot is O(1) if the frame has
+   * cheap snapshots, and a copy of the
+   * global bindings otherwise.
+   */
+  Frame* global_f = env->global_frame();
+  Frame::BindingMap saved;
+  if (rollback_on_error) {
+    saved = global_f->snapshot();
+  }
   try {
-    Cell* root = parse(sexpr);
+    Cell* root = reader.read();
+    if (root == NULL) {
+      return false;
+    }
     Cell* result = eval(root);
     if ( result == nil ) {
-      cout << "()" << endl;
+      cout << "()" << '\n';
     } else {
-      cout << *result << endl;
+      cout << *result << '\n';
     }
     // delete root;
     // delete result;
   } catch (runtime_error &e) {
+    if (rollback_on_error) {
+      global_f->restore(saved);
+    }
     cerr << "ERROR: " << e.what() << endl;
   } catch (logic_error &e) {
     cerr << "LOGIC ERROR: " << e.what() << endl;
     exit(1);
   }
+  end_of_form();
+  return true;
 }
 
 /**
- * \brief Read single single symbol into the end of a string buffer.
- * \param fin The input file stream.
- * \param str The string buffer.
+ * \brief Parse and evaluate the s-expressions, and print the results.
+ * \param sexpr The string vaule holding the s-expressions.
  */
-void readsinglesymbol(ifstream& fin, string& str)
+void parse_eval_print(const string& sexpr)
 {
-  char currentchar;
-  fin.get(currentchar);
-  if (fin.eof()) {
-    return;
-  }
-  if (currentchar == '\"') {
-    // read a string literal
-    do {
-      str += currentchar;
-      fin.get(currentchar);
-    } while (currentchar != '\"');
-    str += currentchar;
-  } else {
-    do {
-      str += currentchar;
-      fin.get(currentchar);
-    } while ((false == iswhitespace(currentchar)) 
-	     && ('(' != currentchar) 
-	     && (false == fin.eof()));
-    fin.putback(currentchar);  
+  Reader reader(sexpr);
+  while (read_eval_print(reader)) {
   }
 }
 
 /**
- * \brief Read, parse, evaluate, and print the expression one by one from
- * the input stream.
+ * \brief Read, parse, evaluate, and print the expressions one by one from
+ * the input stream, as they are read.
  *
- * \param fin The input file stream.
+ * \param in The input stream.
  */
-void readfile(ifstream& fin)
+void readfile(istream& in)
 {
-  string sexp;
-  bool isstartsexp = false;
-  int inumleftparenthesis = 0;
-
-  // check whether to read the end
-  while (!fin.eof()) {
-    // read char by char
-    char currentchar;
-    fin.get(currentchar);
-    if (fin.eof()) {
-      break;
-    }
-
-    // skip some white space before new s-expression occurs
-    if ((true == iswhitespace(currentchar))&&(false == isstartsexp)) {
-      continue;
-    }
-    // run across a new s-expression
-    if ((false == isstartsexp)&&(false == iswhitespace(currentchar))) {
-      // check whether single symbol
-      if ('(' != currentchar)	{
-	// read a single symbol
-	fin.putback(currentchar);
-	readsinglesymbol(fin, sexp);
-	// call function
-	parse_eval_print(sexp);
-	sexp.clear();
-      }	else {
-	// start new expression
-	isstartsexp = true;
-	// read left parenthesis
-	sexp += currentchar;
-	inumleftparenthesis = 1;
-      }
-    } else {
-      // in the process of reading the current s-expression
-      if (true == isstartsexp) {
-	if (true == iswhitespace(currentchar)) {
-	  // append a blankspace
-	  //sexp += ' ';
-	  sexp += currentchar;
-	} else {
-	  // append current character
-	  sexp += currentchar;
-	  // count left parenthesis
-	  if ('(' == currentchar) {
-	    inumleftparenthesis ++;
-	  }
-	  if (')' == currentchar) {
-	    inumleftparenthesis --;
-	    // check whether current s-expression ends
-	    if (0 == inumleftparenthesis) {
-	      // current s-expression ends
-	      isstartsexp  =  false;
-	      // call functions
-	      parse_eval_print(sexp);
-	      sexp.clear();
-	    }
-	  }
-	}
-      }
-    }
+  Reader reader(in);
+  while (read_eval_print(reader)) {
   }
 }
 
@@ -145,7 +93,7 @@ void readfile(ifstream& fin)
  * \brief Read the expressions from the file.
  * \param fn The file name.
  */
-void readfile(char* fn)
+void readfile(const char* fn)
 {
   ifstream fin(fn);
   readfile(fin);
@@ -173,11 +121,59 @@ void readconsole()
   } while (true);
 }
 
+/**
+ * \brief Read the flush policy option, one of --flush=form,
+ * --flush=exit or --flush=N to flush every N bytes.
+ * Exit if the option has a bad value.
+ * \return True iff arg is a flush policy option.
+ */
+bool read_flush_option(const char* arg, FlushPolicy& policy, size_t& bytes)
+{
+  const char* prefix = "--flush=";
+  if (strncmp(arg, prefix, strlen(prefix)) != 0) {
+    return false;
+  }
+  const char* value = arg + strlen(prefix);
+  if (0 == strcmp(value, "form")) {
+    policy = FLUSH_PER_FORM;
+  } else if (0 == strcmp(value, "exit")) {
+    policy = FLUSH_AT_EXIT;
+  } else {
+    char* end;
+    long n = strtol(value, &end, 10);
+    if (('\0' != *end) || (n <= 0)) {
+      cerr << "bad flush option: " << arg << endl;
+      exit(1);
+    }
+    policy = FLUSH_PER_BYTES;
+    bytes = n;
+  }
+  return true;
+}
+
 /**
  * \brief Call either the batch or interactive main drivers.
+ * The output of a batch is written out at exit, and the interactive
+ * one after each form, unless a --flush option comes first.
+ * With a --rollback option, an expression that fails undoes the
+ * definitions it made in the global frame.
  */
 int main(int argc, char* argv[])
 {
+  // cin reads blocks of its own, not through stdio.
+  ios_base::sync_with_stdio(false);
+  FlushPolicy policy = (argc > 1) ? FLUSH_AT_EXIT : FLUSH_PER_FORM;
+  size_t bytes = DEFAULT_OUTPUT_BUFFER;
+  while (argc > 1) {
+    if (0 == strcmp(argv[1], "--rollback")) {
+      rollback_on_error = true;
+    } else if (!read_flush_option(argv[1], policy, bytes)) {
+      break;
+    }
+    --argc;
+    ++argv;
+  }
+  buffer_output(policy, bytes);
   switch(argc) {
   case 1:
     // read from the standard input
@@ -186,8 +182,12 @@ int main(int argc, char* argv[])
     exit(0);
     break;
   case 2:
-    // read from a file
-    readfile(argv[1]);
+    // read from a file, or from the standard input if it's -
+    if (0 == strcmp(argv[1], "-")) {
+      readfile(cin);
+    } else {
+      readfile(argv[1]);
+    }
     break;
   default:
     cout << "too many arguments!" << endl;
@@ -0,0 +1,92 @@
+/**
+ * \file mapstats.hpp
+ *
+ * Occupancy and probe length statistics of the hash table maps, as
+ * returned by their stats() member. The same fields are filled in by
+ * every map, so tables of different kinds can be compared directly.
+ */
+
+#ifndef MAPSTATS_HPP
+#define MAPSTATS_HPP
+
+#include <iostream>
+#include <vector>
+
+/**
+ * \class map_stats
+ * \brief A snapshot of the shape of a hash table and the
+ * counts of the operations done on it.
+ */
+struct map_stats {
+  map_stats():
+    size(0), bucket_count(0), load_factor(0),
+    inserts(0), finds(0), misses(0),
+    avg_probe(0), max_probe(0) {}
+
+  // number of entries and buckets, and their ratio.
+  unsigned int size, bucket_count;
+  float load_factor;
+
+  // entries inserted, key lookups started (including
+  // the one each insert does first), and lookups
+  // that didn't find their key.
+  unsigned int inserts, finds, misses;
+
+  /**
+   * chain_lengths[k] is the number of buckets
+   * that k entries hash to, a bucket being a
+   * chain, a home slot or a home group of slots.
+   * probe_lengths[k] is the number of entries
+   * found by looking at k nodes, slots or groups.
+   */
+  std::vector<unsigned int> chain_lengths;
+  std::vector<unsigned int> probe_lengths;
+  float avg_probe;
+  unsigned int max_probe;
+};
+
+/**
+ * \brief Add one to histogram[k], growing the histogram if needed.
+ */
+inline void add_to_histogram(std::vector<unsigned int>& histogram, unsigned int k)
+{
+  if (histogram.size() <= k) histogram.resize(k + 1, 0);
+  ++histogram[k];
+}
+
+/**
+ * \brief Fill in avg_probe and max_probe from probe_lengths.
+ */
+inline void summarize_probes(map_stats& s)
+{
+  unsigned long total = 0, entries = 0;
+  for (unsigned int k=0; k<s.probe_lengths.size(); ++k) {
+    total += static_cast<unsigned long>(k) * s.probe_lengths[k];
+    entries += s.probe_lengths[k];
+    if (s.probe_lengths[k]) s.max_probe = k;
+  }
+  s.avg_probe = entries ? static_cast<float>(total) / entries : 0;
+}
+
+/**
+ * \brief Print the stats on one line, the histograms as lists of
+ * counts starting from length 0.
+ */
+inline std::ostream& operator<<(std::ostream& os, const map_stats& s)
+{
+  os << "size " << s.size << " buckets " << s.bucket_count
+     << " load " << s.load_factor
+     << " inserts " << s.inserts << " finds " << s.finds << " misses " << s.misses
+     << " avg-probe " << s.avg_probe << " max-probe " << s.max_probe
+     << " chains (";
+  for (unsigned int k=0; k<s.chain_lengths.size(); ++k) {
+    os << (k ? " " : "") << s.chain_lengths[k];
+  }
+  os << ") probes (";
+  for (unsigned int k=0; k<s.probe_lengths.size(); ++k) {
+    os << (k ? " " : "") << s.probe_lengths[k];
+  }
+  return os << ")";
+}
+
+#endif // MAPSTATS_HPP
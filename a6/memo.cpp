@@ -0,0 +1,157 @@
+/**
+ * \file memo.cpp
+ *
+ * An implementation of the memo.hpp interface. The cached results are
+ * kept in a hashtablemap keyed on a string encoding the structure of the
+ * argument values, and in a doubly linked list ordered by recent use.
+ */
+
+#include <charconv>
+#include <cstring>
+#include "memo.hpp"
+
+using namespace std;
+
+MemoTable::MemoTable(int my_capacity):
+  head(NULL), tail(NULL), capacity_m(my_capacity),
+  hits_m(0), misses_m(0), refs(1)
+{
+  // the table never holds more than capacity_m results.
+  if (capacity_m > 0) entries.reserve(capacity_m);
+}
+
+MemoTable::~MemoTable() {
+  Entry* e = head;
+  while (e != NULL) {
+    Entry* next = e->next;
+    if (e->value != nil) delete e->value;
+    delete e;
+    e = next;
+  }
+}
+
+MemoTable* MemoTable::retain() {
+  ++refs;
+  return this;
+}
+
+void MemoTable::release() {
+  --refs;
+  if (refs == 0) delete this;
+}
+
+bool MemoTable::make_key(Cell** args, int n, string& key) {
+  for (int i=0; i<n; ++i) {
+    if (!_append_key(args[i], key)) return false;
+  }
+  return true;
+}
+
+// large enough for the tag, a 64 bit value and the separator.
+const int KEY_BUFFER_SIZE = 32;
+
+bool MemoTable::_append_key(Cell* c, string& key) {
+  /**
+   * every kind of value starts with its
+   * own tag, so different structures
+   * never get the same key. doubles are
+   * keyed on their bits, not on the six
+   * digits they are printed with.
+   */
+  while (c->is_cons()) {
+    key += '(';
+    if (!_append_key(c->get_car(), key)) return false;
+    c = c->get_cdr();
+  }
+  if (c == nil) {
+    key += ')';
+  }
+  else if (c->is_int()) {
+    char buf[KEY_BUFFER_SIZE];
+    buf[0] = 'i';
+    char* end = to_chars(buf + 1, buf + KEY_BUFFER_SIZE - 1, c->get_int()).ptr;
+    *end++ = ' ';
+    key.append(buf, end - buf);
+  }
+  else if (c->is_double()) {
+    double d = c->get_double();
+    unsigned long long bits;
+    memcpy(&bits, &d, sizeof(bits));
+    char buf[KEY_BUFFER_SIZE];
+    buf[0] = 'd';
+    char* end = to_chars(buf + 1, buf + KEY_BUFFER_SIZE - 1, bits, 16).ptr;
+    *end++ = ' ';
+    key.append(buf, end - buf);
+  }
+  else if (c->is_symbol()) {
+    key += 's';
+    key += c->get_symbol_name();
+    key += ' ';
+  }
+  else {
+    // functions have no structure to compare.
+    return false;
+  }
+  return true;
+}
+
+Cell* MemoTable::look_up(const string& key) {
+  hashtablemap<string, Entry*>::iterator it = entries.find(key);
+  if (it == entries.end()) {
+    ++misses_m;
+    return NULL;
+  }
+  ++hits_m;
+  Entry* e = it->second;
+  if (e != head) {
+    _unlink(e);
+    _push_front(e);
+  }
+  return e->value->copy();
+}
+
+void MemoTable::insert(const string& key, Cell* value) {
+  if (capacity_m <= 0 || entries.count(key)) {
+    return;
+  }
+  if (static_cast<int>(entries.size()) >= capacity_m) {
+    // evict the least recently used result.
+    Entry* lru = tail;
+    _unlink(lru);
+    entries.erase(lru->key);
+    if (lru->value != nil) delete lru->value;
+    delete lru;
+  }
+  Entry* e = new Entry(key, value->copy());
+  _push_front(e);
+  entries.insert(pair<string, Entry*>(key, e));
+}
+
+int MemoTable::hits() const {
+  return hits_m;
+}
+
+int MemoTable::misses() const {
+  return misses_m;
+}
+
+int MemoTable::size() const {
+  return entries.size();
+}
+
+void MemoTable::_unlink(Entry* e) {
+  if (e->prev != NULL) e->prev->next = e->next;
+  else head = e->next;
+  if (e->next != NULL) e->next->prev = e->prev;
+  else tail = e->prev;
+  e->prev = NULL;
+  e->next = NULL;
+}
+
+void MemoTable::_push_front(Entry* e) {
+  e->next = head;
+  e->prev = NULL;
+  if (head != NULL) head->prev = e;
+  head = e;
+  if (tail == NULL) tail = e;
+}
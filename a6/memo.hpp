@@ -0,0 +1,126 @@
+/**
+ * \file memo.hpp
+ *
+ * Interface of the result cache of memoized user defined functions.
+ * A memoized function maps the structure of its argument values to the
+ * value it returned for them, so it must be pure for the cache to be
+ * correct. The cache has a bounded size, evicting the least recently
+ * used result first.
+ */
+
+#ifndef MEMO_HPP
+#define MEMO_HPP
+
+#include <string>
+#include "Cell.hpp"
+#include "hashtablemap.hpp"
+
+/**
+ * \class MemoTable
+ * \brief LRU cache of the results of a memoized function.
+ * Shared by all copies of the ProcedureCell it belongs to,
+ * and deleted when the last of them releases it.
+ */
+class MemoTable {
+public:
+  /**
+   * \brief Constructor.
+   * \param my_capacity The maximum number of cached results.
+   */
+  MemoTable(int my_capacity);
+
+  /**
+   * \brief Destructor. Delete all cached results.
+   */
+  ~MemoTable();
+
+  /**
+   * \brief Register one more ProcedureCell sharing this table.
+   * \return This table.
+   */
+  MemoTable* retain();
+
+  /**
+   * \brief Unregister a ProcedureCell sharing this table,
+   * delete the table if it was the last one.
+   */
+  void release();
+
+  /**
+   * \brief Build the key identifying the structure of n argument values.
+   * \param args The argument values.
+   * \param n The number of values in args.
+   * \param key The string to append the key to.
+   * \return False if some argument (such as a function) has no
+   * structural key, in which case the call cannot be cached.
+   */
+  static bool make_key(Cell** args, int n, std::string& key);
+
+  /**
+   * \brief Look up the result cached for key, and count a hit or miss.
+   * A hit makes the result the most recently used one.
+   * \return A copy of the cached result, NULL if there's none.
+   */
+  Cell* look_up(const std::string& key);
+
+  /**
+   * \brief Cache a copy of value as the result for key, evicting the
+   * least recently used result if the table is full.
+   */
+  void insert(const std::string& key, Cell* value);
+
+  /**
+   * \brief Accessor.
+   * \return Number of look ups that found a cached result.
+   */
+  int hits() const;
+
+  /**
+   * \brief Accessor.
+   * \return Number of look ups that found no cached result.
+   */
+  int misses() const;
+
+  /**
+   * \brief Accessor.
+   * \return Number of results currently cached.
+   */
+  int size() const;
+
+private:
+  /**
+   * \class Entry
+   * \brief A cached result, linked in order of use.
+   */
+  struct Entry {
+    Entry(const std::string& my_key, Cell* my_value):
+      key(my_key), value(my_value), prev(NULL), next(NULL) {}
+    std::string key;
+    Cell* value;
+    Entry* prev;
+    Entry* next;
+  };
+
+  /**
+   * \brief Append the key of a single value to key.
+   * \return False if c has no structural key.
+   */
+  static bool _append_key(Cell* c, std::string& key);
+
+  // unlink e from the list of entries.
+  void _unlink(Entry* e);
+
+  // link e as the most recently used entry.
+  void _push_front(Entry* e);
+
+  hashtablemap<std::string, Entry*> entries;
+  // most and least recently used entries.
+  Entry* head;
+  Entry* tail;
+  int capacity_m;
+  int hits_m;
+  int misses_m;
+  int refs;
+};
+
+#endif // MEMO_HPP
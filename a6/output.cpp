@@ -0,0 +1,78 @@
+/**
+ * \file output.cpp
+ *
+ * An implementation of the output.hpp interface.
+ */
+
+#include <cstdio>
+#include <iostream>
+#include "output.hpp"
+
+using namespace std;
+
+OutputBuffer::OutputBuffer():
+  buffer(NULL), capacity(0), policy(FLUSH_PER_FORM), saved(NULL) {}
+
+OutputBuffer::~OutputBuffer() {
+  if (saved != NULL) {
+    write_out();
+    cout.rdbuf(saved);
+  }
+  delete [] buffer;
+}
+
+void OutputBuffer::install(FlushPolicy my_policy, size_t bytes) {
+  if (saved != NULL) {
+    write_out();
+    delete [] buffer;
+  }
+  else {
+    cout.flush();
+    saved = cout.rdbuf(this);
+  }
+  policy = my_policy;
+  capacity = bytes > 0 ? bytes : 1;
+  buffer = new char[capacity];
+  setp(buffer, buffer + capacity);
+}
+
+void OutputBuffer::end_form() {
+  if (policy == FLUSH_PER_FORM) write_out();
+}
+
+int OutputBuffer::overflow(int c) {
+  if (!write_out()) return traits_type::eof();
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    // a full buffer of one byte goes out right away.
+    if (pptr() == epptr() && !write_out()) return traits_type::eof();
+  }
+  return traits_type::not_eof(c);
+}
+
+int OutputBuffer::sync() {
+  return write_out() ? 0 : -1;
+}
+
+bool OutputBuffer::write_out() {
+  size_t n = pptr() - pbase();
+  setp(buffer, buffer + capacity);
+  if (n == 0) return true;
+  // through stdio, so that it stays in order with
+  // anything else written to stdout.
+  bool written = fwrite(buffer, 1, n, stdout) == n;
+  return fflush(stdout) == 0 && written;
+}
+
+// destroyed at exit, before the standard streams are
+// flushed for the last time.
+static OutputBuffer output;
+
+void buffer_output(FlushPolicy policy, size_t bytes) {
+  output.install(policy, bytes);
+}
+
+void end_of_form() {
+  output.end_form();
+}
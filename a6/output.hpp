@@ -0,0 +1,98 @@
+/**
+ * \file output.hpp
+ *
+ * Interface of the buffered standard output of the interpreter. The
+ * results of the forms are written to cout, which is routed through a
+ * buffer and written out by a flush policy, instead of once per line.
+ * cerr stays tied to cout, so an error still comes after the output
+ * of the forms before it.
+ */
+
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+
+#include <cstddef>
+#include <streambuf>
+
+/**
+ * \brief When the buffered output is written out. It's always written
+ * out when the buffer is full, before anything is written to cerr or
+ * read from cin, and at exit.
+ */
+enum FlushPolicy {
+  FLUSH_PER_FORM,   ///< also after each top-level form.
+  FLUSH_PER_BYTES,  ///< also whenever the given number of bytes is buffered.
+  FLUSH_AT_EXIT     ///< no more often than that.
+};
+
+/**
+ * \brief The size of the output buffer, unless flushing per bytes.
+ */
+const size_t DEFAULT_OUTPUT_BUFFER = 65536;
+
+/**
+ * \class OutputBuffer
+ * \brief Stream buffer writing to the standard output in blocks.
+ */
+class OutputBuffer: public std::streambuf {
+public:
+  /**
+   * \brief Constructor. Nothing is routed through the buffer until
+   * buffer_output is called.
+   */
+  OutputBuffer();
+
+  /**
+   * \brief Destructor. Write out what's left and give cout its
+   * own buffer back.
+   */
+  ~OutputBuffer();
+
+  /**
+   * \brief Route cout through this buffer.
+   * \param my_policy When to write the output out.
+   * \param bytes The size of the buffer, the number of bytes between
+   * flushes if my_policy is FLUSH_PER_BYTES.
+   */
+  void install(FlushPolicy my_policy, size_t bytes);
+
+  /**
+   * \brief Mark the end of a top-level form.
+   */
+  void end_form();
+
+protected:
+  virtual int overflow(int c);
+
+  virtual int sync();
+
+private:
+  /**
+   * \brief Write the buffered output to the standard output.
+   * \return False if it couldn't be written.
+   */
+  bool write_out();
+
+  char* buffer;
+  size_t capacity;
+  FlushPolicy policy;
+  // the buffer cout had before.
+  std::streambuf* saved;
+};
+
+/**
+ * \brief Route cout through a buffer written out by policy. Called
+ * once, before anything is printed.
+ * \param policy When to write the output out.
+ * \param bytes The size of the buffer, the number of bytes between
+ * flushes if policy is FLUSH_PER_BYTES.
+ */
+void buffer_output(FlushPolicy policy, size_t bytes = DEFAULT_OUTPUT_BUFFER);
+
+/**
+ * \brief Mark the end of a top-level form, writing the output out
+ * if the policy is FLUSH_PER_FORM.
+ */
+void end_of_form();
+
+#endif // OUTPUT_HPP
@@ -1,12 +1,17 @@
 /**
  * \file parse.cpp
  *
- * Implementation of a parser that analyzes a string containing an
- * s-expression, and determines its tree structure.
+ * Implementation of a parser that analyzes a string or an input stream
+ * containing s-expressions, and determines their tree structure. The
+ * input is read once from left to right, building the cells as it goes.
  */
 
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <vector>
 #include "parse.hpp"
-bool inparsecar;
+
 // check whether chr is white space
 bool iswhitespace(char ch)
 {
@@ -17,364 +22,256 @@ bool iswhitespace(char ch)
   }
 }
 
+/**
+ * \brief Check whether ch ends a symbol or numeric literal.
+ */
+bool isdelimiter(char ch)
+{
+  return iswhitespace(ch) || ('(' == ch) || (')' == ch) || ('\"' == ch);
+}
 
 /**
- * \brief Check whether numericstr is an legal numericstr string
- * \param str The string to be checked
- * \return ture if numericstr is an legal numericstr string, false otherwise
+ * \brief Validate and convert a numeric literal in one pass.
+ * \param first The first character of the literal.
+ * \param last One past its last character.
+ * \return The IntCell or DoubleCell, NULL if the literal is illegal
+ * or out of range.
  */
-bool is_legalnumeric(string str) 
+Cell* makenumber(const char* first, const char* last)
 {
-  int dotnum = 0;
-  int length = str.length();
-  int i;
-  if ('.' == str[0]) {
-    dotnum ++;
-  } else if ( !((str[0] >= '0') && (str[0] <= '9')) && ('+'!=str[0]) && ('-'!=str[0])) {
-    return false;
+  bool negative = ('-' == *first);
+  if (('+' == *first) || ('-' == *first)) {
+    ++first;
   }
-  for (i = 1; i < length; i ++) {
-    if ('.' == str[i]) {
-      dotnum ++;
-    } else if ((str[i] < '0') || (str[i] > '9')) {
-      return false;
+  // the digits before any point make an int.
+  const char* p = first;
+  long long value = 0;
+  while (p != last && (*p >= '0') && (*p <= '9')) {
+    if (value <= INT_MAX) {
+      value = value * 10 + (*p - '0');
     }
+    ++p;
   }
-  if (dotnum>1) {
-    return false;
+  if (p == last) {
+    if (p == first) {
+      return NULL;
+    }
+    if (negative) {
+      value = -value;
+    }
+    if ((value > INT_MAX) || (value < INT_MIN)) {
+      return NULL;
+    }
+    return make_int(static_cast<int>(value));
   }
-  return true;
+  if ('.' != *p) {
+    return NULL;
+  }
+  // this is a double, a point alone reads as 0.
+  if (last - first == 1) {
+    return make_double(0);
+  }
+  double fvalue;
+  from_chars_result result = from_chars(first, last, fvalue, chars_format::fixed);
+  if ((result.ec != errc()) || (result.ptr != last)) {
+    return NULL;
+  }
+  return make_double(negative ? -fvalue : fvalue);
 }
 
 /**
- * \brief Check whether str is a legal operator
- * 
+ * \brief Make the cell of a symbol or numeric literal.
+ * \param first The first character of the token.
+ * \param last One past its last character.
  */
-bool is_legaloperator(string str)
+Cell* makecell(const char* first, const char* last)
 {
-  return true;
+  if (((*first >= '0') && (*first <= '9')) || (*first == '.') 
+      || ((('+' == *first) || ('-' == *first)) && (last - first > 1))) {
+    // this is a numeric literal
+    Cell* root = makenumber(first, last);
+    if (NULL == root) {
+      throw runtime_error("illegal numeric literal " + string(first, last));
+    }
+    return root;
+  }
+  // this is a symbol
+  return make_symbol(first, last - first);
 }
 
-void readsinglesymbol(string& substring, string& sexpr)
-{
-  char currentchar;
-  int i = 0;
-  int length = substring.length();
+Reader::Reader(const string& text):
+  in(NULL), p(text.data()), end(text.data() + text.size()) {}
 
-  // get the first character
-  currentchar = substring[i];
+Reader::Reader(istream& my_in):
+  in(&my_in), buffer(READ_BLOCK), p(buffer.data()), end(buffer.data()) {}
 
-  if (currentchar == '\"') {
-    // read a string literal
-    sexpr += currentchar;
-    do {
-      ++i;
-      currentchar = substring[i];
-      sexpr += currentchar;
-    } while (currentchar != '\"' && i < length-1);
-    if ('\"' != currentchar) {
-      cout << "error: illegal string" << endl;
-      exit(1);
-    }
+bool Reader::refill(const char*& keep)
+{
+  if (NULL == in) {
+    return false;
+  }
+  size_t kept = end - keep;
+  size_t offset = p - keep;
+  // a token as long as the buffer makes it grow.
+  if (kept == buffer.size()) {
+    vector<char> bigger(2 * buffer.size());
+    memcpy(bigger.data(), keep, kept);
+    buffer.swap(bigger);
   } else {
-    // read a numeric literal or operator
-    do {
-      sexpr += currentchar;
-      ++i;
-      if (i >= static_cast<int>(substring.size())) {
-	break;
-      }
-      currentchar = substring[i];
-    } while ((!iswhitespace(currentchar)) && (currentchar != '(') && currentchar != '\"');
-    --i;
+    memmove(buffer.data(), keep, kept);
   }
-  substring = substring.substr(i+1, length - i - 1);
+  char* data = buffer.data();
+  // wait for one character, then take what's already
+  // there, so that a pipe is read as it's written.
+  size_t n = 0;
+  if (in->read(data + kept, 1)) {
+    n = 1 + in->readsome(data + kept + 1, buffer.size() - kept - 1);
+  }
+  keep = data;
+  p = data + offset;
+  end = data + kept + n;
+  return n > 0;
 }
 
-
-/**
- * \brief Clear the whitespace at the begining and end of string sexpr.
- * \param sexpr The string.
- */
-void clearwhitespace(string& sexpr)
+bool Reader::skipwhitespace()
 {
-  if (sexpr.size() <= 0) {
-    return;
-  }
-  int leftvalidpos;
-  int rightvalidpos;
-  int length = sexpr.size();
-  int i;
-  // most left non-whitespace position
-  for (i = 0; i < length; ++i) {
-    if (iswhitespace(sexpr[i])) {
-      continue;
-    } else {
-      leftvalidpos = i;
-      break;
+  while (true) {
+    while ((p != end) && iswhitespace(*p)) {
+      ++p;
+    }
+    if (p != end) {
+      return true;
+    }
+    const char* keep = end;
+    if (!refill(keep)) {
+      return false;
     }
   }
+}
 
-  // most right non-whitespace position
-  for (i = length - 1; i >= 0; i --) {
-    if (iswhitespace(sexpr[i])) {
-      continue;
-    } else {
-      rightvalidpos = i;
-      break;
-    }
+Cell* Reader::read()
+{
+  if (!skipwhitespace()) {
+    return NULL;
   }
+  return readsexpr();
+}
 
-  // delete the white space at the beginning and end
-  if ( i == -1 ) sexpr = "";
-  else sexpr  =  sexpr.substr(leftvalidpos, rightvalidpos - leftvalidpos + 1);
+bool Reader::at_end()
+{
+  return !skipwhitespace();
 }
 
-/**
- * \brief Check whether the s-expression legal
- */
-bool is_legalexpr(string sexpr)
+Cell* Reader::readsexpr()
 {
-  clearwhitespace(sexpr);
-  if (sexpr.length()==0) {
-    cout << "blank string " << endl;
-    return false;
-  }
-  if (')' == sexpr[0]) {
-    cout << "error: illegal s-expression" << endl;
-    return false;
-  }
-  if ('(' == sexpr[0]) {
-    // it is expression
-    int length = sexpr.length();
-    int inumleftparenthesis = 1;
-    int i;
-    int quotationmark = 0;
-    for (i = 1; i < length; i ++ ) {
-      if ('\"' == sexpr[i]) {
-        quotationmark ++;
-        quotationmark = quotationmark%2;
-      } else if ('(' == sexpr[i] && 0 == quotationmark) {
-        inumleftparenthesis ++;
-      } else if (')' == sexpr[i] && 0 == quotationmark) {
-        inumleftparenthesis --;
-      }
-      if (0 == inumleftparenthesis) {
-        break;
+  // the elements of the open lists, and where each open
+  // list starts among them. Lists are read with these
+  // instead of recursion, so the nesting depth is only
+  // limited by memory.
+  vector<Cell*> elements;
+  vector<size_t> opens;
+  try {
+    while (true) {
+      if (!skipwhitespace()) {
+        throw runtime_error("illegal s-expression, missing )");
       }
-    }
-    if ((i < length - 1) || (i == length) || (inumleftparenthesis > 0) || 0 != quotationmark) {
-      cout << "error: illegal s-expression " << endl;
-      return false;
-    }
-  } else if ('\"' != sexpr[0]) {
-    // single element
-    if (string::npos != sexpr.find('(') || string::npos != sexpr.find(')') || string::npos != sexpr.find(' ') || string::npos != sexpr.find('\"'))  {
-      cout << "error: illegal s-expression " << endl;
-      return false;
-    }
-    // check whether str is illegal numeric literal or illegal operator
-    if ((false == is_legalnumeric(sexpr)) && (false ==is_legaloperator(sexpr))) {
-      cout << "error: illegal numeric literal or illegal operator" << endl;
-      return false;
-    }
-  } else {
-    int length = sexpr.length();
-    int inumleft = 1;
-    int i;
-    for (i = 1; i < length; i ++) {
-      if ('\"' == sexpr[i]) {
-        inumleft ++;
+      Cell* value;
+      if ('(' == *p) {
+        ++p;
+        opens.push_back(elements.size());
+        continue;
+      } else if (')' == *p) {
+        ++p;
+        if (opens.empty()) {
+          throw runtime_error("illegal s-expression, unexpected )");
+        }
+        // the list is consed from its last element.
+        value = nil;
+        while (elements.size() > opens.back()) {
+          value = cons(elements.back(), value);
+          elements.pop_back();
+        }
+        opens.pop_back();
+      } else if ('\"' == *p) {
+        // a string literal is kept as a symbol, quotes included.
+        const char* first = p;
+        ++p;
+        while (true) {
+          while ((p != end) && ('\"' != *p)) {
+            ++p;
+          }
+          if (p != end) {
+            break;
+          }
+          if (!refill(first)) {
+            throw runtime_error("illegal string, missing \"");
+          }
+        }
+        ++p;
+        value = make_symbol(first, p - first);
+      } else {
+        const char* first = p;
+        while (true) {
+          while ((p != end) && !isdelimiter(*p)) {
+            ++p;
+          }
+          if ((p != end) || !refill(first)) {
+            break;
+          }
+        }
+        value = makecell(first, p);
       }
-      if (2 == inumleft) {
-        break;
+      if (opens.empty()) {
+        return value;
       }
+      elements.push_back(value);
     }
-    if ((i < length-1) || (inumleft != 2)) {
-      cout << "error: illegal s-expression " << endl;
-      return false;
+  } catch (runtime_error&) {
+    for (size_t i = 0; i < elements.size(); ++i) {
+      if (elements[i] != nil) delete elements[i];
     }
+    skiplists(opens.size());
+    throw;
   }
-  return true;
 }
 
-/**
- * \brief Make the cell.
- * \param str The string to represent the symbol, int or double.
- */
-Cell* makecell(string str)
+void Reader::skiplists(size_t depth)
 {
-  Cell* root;
-  if (((str[0] >= '0') && (str[0] <= '9')) || (str[0] == '.') 
-      || ((('+'==str[0]) || ('-'==str[0]))&&(str.length()>1))) {
-    if (false == is_legalnumeric(str)) {
-      cout << "error: illegal numeric literal" << endl;
-      exit(1);
-    }
-    // this is a numeric literal
-    if (string::npos == str.find('.')) {
-      // int number
-      char* fchar = const_cast<char*>(str.c_str());
-      int value = atoi(fchar);
-      root = make_int(value);
-    } else {
-      // this is a double
-      char* fchar = const_cast<char*>(str.c_str());
-      double value = atof(fchar);   
-      root = make_double(value);
-    }
-  } 
-  
-  // we don't deal with literal strings right now, so they are commented out
-  // else if (str[0] == '\"') {
-//     // this is a string literal
-//     string strval = str.substr(1, str.size() - 2);
-//     root = make_string(const_cast<char*>(strval.data()));
-//   } 
-  else {
-    // this is a symbol
-    if (false == is_legaloperator(str)) {
-      cout << "error: illegal operator" << endl;
-      exit(1);
+  while ((depth > 0) && skipwhitespace()) {
+    char ch = *p;
+    ++p;
+    if ('(' == ch) {
+      ++depth;
+    } else if (')' == ch) {
+      --depth;
+    } else if ('\"' == ch) {
+      while (true) {
+        while ((p != end) && ('\"' != *p)) {
+          ++p;
+        }
+        if (p != end) {
+          ++p;
+          break;
+        }
+        const char* keep = end;
+        if (!refill(keep)) {
+          return;
+        }
+      }
     }
-    root = make_symbol(const_cast<char*>(str.data()));
   }
-  return root;
 }
 
-Cell* separate_parse(string& sexpr); 
-
-Cell* parse(string sexpr)
+Cell* parse(const string& sexpr)
 {
-  // is_legal(sexpr);
-  // delete the whitesapce at the begining and end
-  // such that the first and last character are not white space
-  clearwhitespace(sexpr);
-//   if (sexpr.length() == 0) {
-//     return nil;
-//   }
-  if (sexpr.length() == 0) {
+  Reader reader(sexpr);
+  Cell* root = reader.read();
+  if (NULL == root) {
     return nil;
   }
-  if ( !is_legalexpr(sexpr)) {
-    return nil;
-  }
-  // check whether is single symbol
-  // i.e. leaf cell
-  // if (string::npos == sexpr.find('(')) {
-  if ('(' != sexpr[0]) {
-    // this is leaf cell
-    // bulid this leaf cell
-    Cell* root = makecell( sexpr );
-    return root;
+  if (!reader.at_end()) {
+    if (root != nil) delete root;
+    throw runtime_error("illegal s-expression, more than one in " + sexpr);
   }
-
-  // the first and last character are '(' and ')', respectively
-  // delete the two characters
-  int length = sexpr.size();
-  sexpr = sexpr.substr(1, length-2);
-  clearwhitespace(sexpr);
-  length = sexpr.size();
-//   if ( inparsecar ) {
-//     if (sexpr == "") {
-//       Cell* ec = new Cell("()");
-//       return ec;
-//     }
-//   }
-  // separate the s-expression into two left and right subsexps
-  Cell* root = separate_parse(sexpr);
-
   return root;
 }
-
-/**
- * \brief Separately parse the sexpr and build the tree.
- * \param instr The string which consists of s-expressions.
- * \return A pointer to the conspair cell at the root of the parse tree.
- */
-Cell* separate_parse(string& instr)
-{
-  string sexp;
-  bool isstartsexp = false;
-  int inumleftparenthesis = 0;
-
-  // check whether to read the end
-  clearwhitespace(instr);
-  int length = instr.size();
-    // check whether it is a "()" sexpr
-
-  while (instr.size() > 0) {
-    // read char by char
-    char currentchar = instr[0];
-    // skip some white space before new s-expression occurs
-    if ((true == iswhitespace(currentchar))&&(false == isstartsexp)) {
-      continue;
-    }
-    // run accross a new s-expression
-    if ((false == isstartsexp)&&(false == iswhitespace(currentchar))) {
-      // check whether single symbol
-      if ('(' != currentchar) {
-	// read single a single symbol
-	readsinglesymbol(instr, sexp);
-	clearwhitespace(instr);  
-	inparsecar = true;
-	Cell* car = parse(sexp);
-	inparsecar = false;
-	Cell* cdr = parse("(" + instr + ")");
-	Cell* root = cons(car, cdr);
-	sexp.clear();
-	return root;
-      } else {
-	// start new expression
-	isstartsexp = true;
-	// read left parenthesiss
-	sexp += currentchar;
-	instr = instr.substr(1, instr.size() -1);
-	inumleftparenthesis = 1;
-      }
-    } else {
-      // in the process of reading the current s-expression
-      if (true == isstartsexp) {
-	if (true == iswhitespace(currentchar)) {
-	  // append a blankspace
-	  sexp += ' ';
-	  instr = instr.substr(1, instr.size() -1);
-	} else {
-	  // append current character
-	  sexp += currentchar;
-	  instr = instr.substr(1, instr.size() -1);
-	  // count left parenthesiss
-	  if ('(' == currentchar) {
-	    inumleftparenthesis ++;
-	  }
-	  if (')' == currentchar) {
-	    inumleftparenthesis --;
-
-	    // check whether current s-expression ends
-	    if (0 == inumleftparenthesis) {
-	      // current s-expression ends
-	      isstartsexp = false;
-	      clearwhitespace(instr);
-	      inparsecar = true;
-	      Cell* car = parse(sexp);        
-	      inparsecar = false;
-	      int length = instr.length();
-	      Cell* cdr;
-	      Cell* root;
-	      if (length <= 0) {
-		cdr = nil;
-	      } else {
-		cdr = parse("(" + instr + ")");       
-	      }
-	      root = cons(car, cdr);
-	      sexp.clear();
-	      return root;     
-	    }
-	  }
-	}
-      }
-    }
-  }
-
-  return nil;
-}
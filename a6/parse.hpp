@@ -9,19 +9,90 @@
 #ifndef PARSE_HPP
 #define PARSE_HPP
 
+#include <istream>
+#include <vector>
 #include "cons.hpp"
 
 using namespace std;
 
 /**
- * \brief Recursively parse sexpr and build the parse tree.  \param
- * sexpr The s-expression stored in a string variable (note that this
- * version of parse has side effects: it may alter the contents of
- * sexpr).
+ * \brief The number of bytes a Reader starts its buffer with.
+ */
+const size_t READ_BLOCK = 65536;
+
+/**
+ * \class Reader
+ * \brief Reads the s-expressions of a string or an input stream one
+ * by one, building their parse trees in a single pass over the input.
+ * A stream is read a block at a time, as the s-expressions need it.
+ */
+class Reader {
+public:
+  /**
+   * \brief Constructor to read the s-expressions in text, which must
+   * outlive the reader.
+   */
+  Reader(const string& text);
+
+  /**
+   * \brief Constructor to read the s-expressions from my_in.
+   */
+  Reader(istream& my_in);
+
+  /**
+   * \brief Read the next s-expression and build its parse tree (error if
+   * it's malformed, the reader then goes on after it).
+   * \return The root of the parse tree, NULL at the end of the input.
+   */
+  Cell* read();
+
+  /**
+   * \brief Check whether only white space is left in the input.
+   */
+  bool at_end();
+
+private:
+  /**
+   * \brief Move p past the white space.
+   * \return False if the input ends before anything else.
+   */
+  bool skipwhitespace();
+
+  /**
+   * \brief Read more of the stream into the buffer, after the
+   * characters from keep to the end of what's read, which are moved to
+   * the front. keep and p are moved with them.
+   * \return False if there's nothing more to read.
+   */
+  bool refill(const char*& keep);
+
+  /**
+   * \brief Read the s-expression starting at p.
+   */
+  Cell* readsexpr();
+
+  /**
+   * \brief Skip the rest of depth lists, after an error inside them.
+   */
+  void skiplists(size_t depth);
+
+  // the stream read from, NULL if reading a string.
+  istream* in;
+  vector<char> buffer;
+  // the next character to read, and the end of those read.
+  const char* p;
+  const char* end;
+};
+
+/**
+ * \brief Parse sexpr and build the parse tree, in one pass over it
+ * (error if sexpr is not a single well-formed s-expression).
+ * \param sexpr The s-expression stored in a string variable.
  *
- * \return A pointer to the conspair cell at the root of the parse tree.
+ * \return A pointer to the conspair cell at the root of the parse tree,
+ * nil if sexpr is blank.
  */
-Cell* parse(string sexpr);
+Cell* parse(const string& sexpr);
 
 /**
  * \brief Check whether the character is whitespace.
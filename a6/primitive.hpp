@@ -2,6 +2,8 @@
  * \file primitive.hpp
  * 
  * Interface of all primitive scheme procedures, implementing natively in c++. 
+ * The arity of each procedure is registered together with it in init_env,
+ * and is checked by PrimitiveCell::call before the procedure is entered.
  */
 
 #ifndef PRIMITIVE_HPP
@@ -9,112 +11,185 @@
 
 /**
  * \brief Evaluation for operator +. Error if an operand doesn't evaluate to IntCell or DoubleCell.
- * \param c The root of the subtree following the + symbol.
+ * \param args The evaluated operands of +.
+ * \param n The number of operands in args.
  * \return The summation of result of evaluating each element in the c.
  * if no operands are given, return 0.
  */
-Cell* eval_addition(Cell* c);
+Cell* eval_addition(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator ceiling. Error if the operand doesn't evaluate to DoubleCell,
  * or more than one operands are passed in.
- * \param c The root of the subtree following the ceiling symbol.
+ * \param args The evaluated operands of ceiling.
+ * \param n The number of operands in args.
  * \return The smallest integer that is greater than or equal to the result of evaluating the operand.
  */
-Cell* eval_ceiling(Cell* c);
+Cell* eval_ceiling(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator floor. Error if the operand doesn't evaluate to DoubleCell,
  * or more than one operands are passed in.
- * \param c The root of the subtree following the floor symbol.
+ * \param args The evaluated operands of floor.
+ * \param n The number of operands in args.
  * \return The greatest integer that is less than or equal to the result of evaluating the operand.
  */
-Cell* eval_floor(Cell* c);
+Cell* eval_floor(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator *. Error if an operand doesn't evaluate to IntCell or DoubleCell.
- * \param c The root of the subtree following the * symbol.
+ * \param args The evaluated operands of *.
+ * \param n The number of operands in args.
  * \return The product of result of evaluating each element in the c.
  * if no operands are given, return 1.
  */
-Cell* eval_multi(Cell* c);
+Cell* eval_multi(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator /. Error if an operand doesn't evaluate to IntCell or DoubleCell,
  * or no operands are given.
- * \param c The root of the subtree following the / symbol.
+ * \param args The evaluated operands of /.
+ * \param n The number of operands in args.
  * \return If there's only one operand, return the inverse of the result of evaluating the operand.
  * Otherwise, Divide the first operand by the other operands.
  */
-Cell* eval_divi(Cell* c);
+Cell* eval_divi(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator -. Error if an operand doesn't evaluate to IntCell or DoubleCell,
  * or no operands are given.
- * \param c The root of the subtree following the - symbol.
+ * \param args The evaluated operands of -.
+ * \param n The number of operands in args.
  * \return If there's only one operand, return the negative of the result of evaluating the operand.
  * Otherwise, subtract other operands from the first operand.
  */
-Cell* eval_subtra(Cell* c);
+Cell* eval_subtra(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator cons. Error if the number of operands is not two.
- * \param c The root of the subtree following the cons symbol.
+ * \param args The evaluated operands of cons.
+ * \param n The number of operands in args.
  * \return A new ConsCell, with first element being the result of evaluating the first operand
  *  and second element being the result of evaluating the second operand.
  */
-Cell* eval_cons(Cell* c);
+Cell* eval_cons(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator car. Error if more than one operands are passed in,
  * or the operand doesn't evaluate to a valid list.
- * \param c The root of the subtree following the car symbol.
+ * \param args The evaluated operands of car.
+ * \param n The number of operands in args.
  * \return The first element of the result of evaluating the operand.
  */
-Cell* eval_car(Cell* c);
+Cell* eval_car(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator cdr. Error if more than one operands are passed in,
  * or the operand doesn't evaluate to a valid list.
- * \param c The root of the subtree following the cdr symbol.
+ * \param args The evaluated operands of cdr.
+ * \param n The number of operands in args.
  * \return The second element of the result of evaluating the operand.
  */
-Cell* eval_cdr(Cell* c);
+Cell* eval_cdr(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator nullp. Error if more than one operands are passed in.
- * \param c The root of the subtree following the nullp symbol.
+ * \param args The evaluated operands of nullp.
+ * \param n The number of operands in args.
  * \return IntCell with value 1, if the operand evaluates to nil, otherwise
  * return IntCell with value 0.
  */
-Cell* eval_nullp(Cell* c);
+Cell* eval_nullp(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator eval. Error if more than one operands are passed in.
- * \param c The root of the subtree following the eval symbol.
+ * \param args The evaluated operands of eval.
+ * \param n The number of operands in args.
  * \return result of evaluating the value of operand.
  */
-Cell* eval_eval(Cell* c);
+Cell* eval_eval(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator print. Error if more than one operands are passed in.
- * \param c The root of the subtree following the print symbol.
+ * \param args The evaluated operands of print.
+ * \param n The number of operands in args.
  * \return Print the value of the operand to standard output stream, return nil.
  */
-Cell* eval_print(Cell* c);
+Cell* eval_print(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator not. Error if more than one operands are passed in.
- * \param c The root of the subtree following the not symbol.
+ * \param args The evaluated operands of not.
+ * \param n The number of operands in args.
  * \return One, if the operand evaluates to zero (either int or double), and zero otherwise.
  */
-Cell* eval_not(Cell* c);
+Cell* eval_not(Cell** args, int n);
 
 /**
  * \brief Evaluation for operator <. Error if an operand doesn't evaluate to IntCell or DoubleCell.
- * \param c The root of the subtree following the < symbol.
+ * \param args The evaluated operands of <.
+ * \param n The number of operands in args.
  * \return Zero if any two consecutive operands are not monotonically increasing, and one otherwise.
  */
-Cell* eval_less_than(Cell* c);
+Cell* eval_less_than(Cell** args, int n);
+
+/**
+ * \brief Evaluation for operator apply. Error if the first operand is not a procedure.
+ * \param args The evaluated operands of apply.
+ * \param n The number of operands in args.
+ * \return The result of applying the first operand to the list given as the second operand.
+ */
+Cell* eval_apply(Cell** args, int n);
+
+/**
+ * \brief Evaluation for operator memoize. Error if the first operand is not
+ * a user defined function. The function must be pure.
+ * \param args The evaluated operands of memoize, the function and optionally
+ * the maximum number of results to cache.
+ * \param n The number of operands in args.
+ * \return A copy of the function, which caches its results by the structure
+ * of its arguments and evicts the least recently used one when full.
+ */
+Cell* eval_memoize(Cell** args, int n);
+
+/**
+ * \brief Evaluation for operator memo-stats. Error if the operand is not a
+ * memoized function.
+ * \param args The evaluated operands of memo-stats.
+ * \param n The number of operands in args.
+ * \return The list (hits misses size) of the cache of the function.
+ */
+Cell* eval_memo_stats(Cell** args, int n);
+
+/**
+ * \brief Evaluation for operator frame-stats. Print the occupancy and
+ * probe length statistics of the global frame's binding table.
+ * \param args The evaluated operands of frame-stats, none.
+ * \param n The number of operands in args.
+ * \return nil.
+ */
+Cell* eval_frame_stats(Cell** args, int n);
+
+/**
+ * \brief Evaluation for operator sample-frame-stats. Error if the operand
+ * is not a non-negative int k. From then on, the binding table statistics
+ * of every k-th procedure frame are printed to standard error when the
+ * call returns, or none if k is 0.
+ * \param args The evaluated operands of sample-frame-stats.
+ * \param n The number of operands in args.
+ * \return nil.
+ */
+Cell* eval_sample_frame_stats(Cell** args, int n);
+
+/**
+ * \brief Evaluation for operator set-print-limits. Error if the operands
+ * are not two non-negative ints length and depth. From then on, lists are
+ * printed up to length elements followed by "...", and lists nested deeper
+ * than depth are printed as "#". A limit of 0 means there is none.
+ * \param args The evaluated operands of set-print-limits.
+ * \param n The number of operands in args.
+ * \return nil.
+ */
+Cell* eval_set_print_limits(Cell** args, int n);
 
 #endif // PRIMITIVE_HPP
@@ -0,0 +1,494 @@
+/**
+ * \file robinhoodmap.hpp
+ *
+ * A map implemented as an open addressing hash table with Robin Hood
+ * linear probing. All entries live in one contiguous array, which grows
+ * once it is more than 7/8 full. Keys are strings. The interface
+ * is the same as hashtablemap's.
+ */
+
+#ifndef ROBINHOODMAP_HPP
+#define ROBINHOODMAP_HPP
+
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "mapstats.hpp"
+#include "strhash.hpp"
+using namespace std;
+
+template <class Key, class T>
+class robinhoodmap
+{
+  typedef robinhoodmap<Key, T>     Self;
+
+public:
+  typedef Key                key_type;
+  typedef T                  data_type;
+  typedef T                  mapped_type;
+  typedef pair<const Key, T> value_type;
+  typedef unsigned int       size_type;
+  typedef int                difference_type;
+
+public:
+
+  /**
+   * \class _iterator.
+   * \brief Iterator over the occupied slots of the table,
+   * in the order of the slots.
+   */
+  template<typename val_T, typename Base_T>
+  class _iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef val_T                     value_type;
+    typedef int                       difference_type;
+    typedef value_type*               pointer;
+    typedef value_type&               reference;
+
+    friend class robinhoodmap;
+
+    _iterator(Base_T* map=NULL, size_type index=0): map_m(map), index_m(index) {}
+    _iterator(const _iterator& x): map_m(x.map_m), index_m(x.index_m) {}
+
+    _iterator& operator=(const _iterator& x) {
+      map_m = x.map_m;
+      index_m = x.index_m;
+      return *this;
+    }
+
+    bool operator==(const _iterator& x) const {
+      return (index_m == x.index_m);
+    }
+
+    bool operator!=(const _iterator& x) const {
+      return (index_m != x.index_m);
+    }
+
+    reference operator*() const {
+      return map_m->_value_at(index_m);
+    }
+
+    pointer operator->() const {
+      return &(map_m->_value_at(index_m));
+    }
+
+    _iterator& operator++() {
+      index_m = map_m->_next_occupied(index_m + 1);
+      return *this;
+    }
+
+    _iterator operator++(int) {
+      _iterator ret(*this);
+      index_m = map_m->_next_occupied(index_m + 1);
+      return ret;
+    }
+
+  private:
+    Base_T* map_m;
+    // index of the slot, the capacity for end().
+    size_type index_m;
+  };
+
+  typedef _iterator<value_type, Self> iterator;
+  typedef _iterator<const value_type, const Self> const_iterator;
+
+public:
+  // default constructor to create an empty map,
+  // with room for m entries before growing.
+  robinhoodmap(size_type m=0):
+    capacity_m(0), size_m(0), dist_m(NULL), hash_m(NULL), slots_m(NULL),
+    inserts_m(0), finds_m(0), misses_m(0)
+  {
+    if (m > 0) _allocate(_capacity_for(m));
+  }
+
+  // overload copy constructor to do a deep copy
+  robinhoodmap(const Self& x):
+    capacity_m(0), size_m(0), dist_m(NULL), hash_m(NULL), slots_m(NULL),
+    inserts_m(0), finds_m(0), misses_m(0)
+  {
+    _copy_from(x);
+  }
+
+  // destructor.
+  ~robinhoodmap() {
+    _destroy();
+  }
+
+  // overload assignment to do a deep copy
+  Self& operator=(const Self& x) {
+    // self assignment protection.
+    if (this != &x) {
+      _destroy();
+      _copy_from(x);
+    }
+    return *this;
+  }
+
+  // accessors:
+  iterator begin() {
+    return iterator(this, _next_occupied(0));
+  }
+  const_iterator begin() const {
+    return const_iterator(this, _next_occupied(0));
+  }
+  iterator end() {
+    return iterator(this, capacity_m);
+  }
+  const_iterator end() const {
+    return const_iterator(this, capacity_m);
+  }
+  bool empty() const {
+    return size_m == 0;
+  }
+  size_type size() const {
+    return size_m;
+  }
+  // number of slots in the table.
+  size_type bucket_count() const {
+    return capacity_m;
+  }
+  float load_factor() const {
+    return capacity_m ? static_cast<float>(size_m) / capacity_m : 0;
+  }
+
+  // the chain length and probe length histograms and the
+  // operation counters of the table. a chain is the set of
+  // entries with the same home slot, and an entry is found
+  // by looking at as many slots as its distance plus one.
+  map_stats stats() const {
+    map_stats s;
+    s.size = size_m;
+    s.bucket_count = capacity_m;
+    s.load_factor = load_factor();
+    s.inserts = inserts_m;
+    s.finds = finds_m;
+    s.misses = misses_m;
+    std::vector<size_type> homes(capacity_m, 0);
+    for (size_type i=0; i<capacity_m; ++i) {
+      if (dist_m[i]) {
+	++homes[hash_m[i] & (capacity_m - 1)];
+	add_to_histogram(s.probe_lengths, dist_m[i]);
+      }
+    }
+    for (size_type i=0; i<capacity_m; ++i) {
+      add_to_histogram(s.chain_lengths, homes[i]);
+    }
+    summarize_probes(s);
+    return s;
+  }
+
+  // insert/erase
+  pair<iterator,bool> insert(const value_type& x) {
+    return _emplace_key(x.first, x);
+  }
+
+  // insert key k with the value built from args, if k's not
+  // in the map yet. nothing is built or moved otherwise.
+  template <class... Args>
+  pair<iterator,bool> try_emplace(const Key& k, Args&&... args) {
+    return _emplace_key(k, piecewise_construct, forward_as_tuple(k),
+			forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template <class... Args>
+  pair<iterator,bool> try_emplace(Key&& k, Args&&... args) {
+    return _emplace_key(k, piecewise_construct, forward_as_tuple(std::move(k)),
+			forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  void erase(iterator pos) {
+    _erase_at(pos.index_m);
+  }
+
+  size_type erase(const Key& x) {
+    size_type i = _find(x, _hash_func(x));
+    if (i == capacity_m) {
+      // the key's not found.
+      return 0;
+    }
+    _erase_at(i);
+    return 1;
+  }
+
+  void clear() {
+    for (size_type i=0; i<capacity_m; ++i) {
+      if (dist_m[i]) {
+	slots_m[i].~slot_type();
+	dist_m[i] = 0;
+      }
+    }
+    size_m = 0;
+  }
+
+  // make room for at least m entries.
+  void reserve(size_type m) {
+    size_type capacity = _capacity_for(m);
+    if (capacity > capacity_m) _rehash(capacity);
+  }
+
+  // map operations:
+  iterator find(const Key& x) {
+    return iterator(this, _find(x, _hash_func(x)));
+  }
+
+  const_iterator find(const Key& x) const {
+    return const_iterator(this, _find(x, _hash_func(x)));
+  }
+
+  // look up by a view of the key, no string is made.
+  iterator find(string_view x) {
+    return iterator(this, _find(x, _hash_func(x)));
+  }
+
+  const_iterator find(string_view x) const {
+    return const_iterator(this, _find(x, _hash_func(x)));
+  }
+
+  iterator find(const char* x) {
+    return find(string_view(x));
+  }
+
+  const_iterator find(const char* x) const {
+    return find(string_view(x));
+  }
+
+  size_type count(const Key& x) const {
+    return count(string_view(x));
+  }
+
+  size_type count(string_view x) const {
+    if (_find(x, _hash_func(x)) != capacity_m) {
+      return 1;
+    }
+    else {
+      return 0;
+    }
+  }
+
+  size_type count(const char* x) const {
+    return count(string_view(x));
+  }
+
+  // if the key's not found, insert
+  // it with default init value.
+  T& operator[](const Key& k) {
+    return try_emplace(k).first->second;
+  }
+
+  T& operator[](Key&& k) {
+    return try_emplace(std::move(k)).first->second;
+  }
+
+private:
+  // what a slot holds, handed out as a value_type.
+  typedef pair<Key, T> slot_type;
+
+  // the entry in slot i, seen with a const key.
+  value_type& _value_at(size_type i) {
+    return *reinterpret_cast<value_type*>(&slots_m[i]);
+  }
+
+  const value_type& _value_at(size_type i) const {
+    return *reinterpret_cast<const value_type*>(&slots_m[i]);
+  }
+
+  // the table grows when size/capacity exceeds 7/8.
+  static constexpr size_type max_load_num = 7;
+  static constexpr size_type max_load_den = 8;
+  static constexpr size_type min_capacity = 8;
+
+  // hash function. currently only work for string.
+  static size_type _hash_func(string_view key) {
+    return hash_string(key.data(), key.size());
+  }
+
+  // smallest power of two capacity holding m entries.
+  size_type _capacity_for(size_type m) const {
+    size_type capacity = min_capacity;
+    while (m * max_load_den > capacity * max_load_num) {
+      capacity *= 2;
+    }
+    return capacity;
+  }
+
+  // find the slot of key x with hash h.
+  // return capacity_m if it is not found.
+  size_type _find(string_view x, size_type h) const {
+    ++finds_m;
+    if (capacity_m == 0) {
+      ++misses_m;
+      return capacity_m;
+    }
+    size_type mask = capacity_m - 1;
+    size_type i = h & mask;
+    // distances are stored plus one, zero means empty.
+    size_type dist = 1;
+    while (dist_m[i] && dist_m[i] >= dist) {
+      if (hash_m[i] == h && slots_m[i].first == x) {
+	return i;
+      }
+      i = (i + 1) & mask;
+      ++dist;
+    }
+    ++misses_m;
+    return capacity_m;
+  }
+
+  // insert the entry built from args, whose key is
+  // k, if k's not in the map yet.
+  template <class... Args>
+  pair<iterator,bool> _emplace_key(string_view k, Args&&... args) {
+    size_type h = _hash_func(k);
+    size_type i = _find(k, h);
+    if (i != capacity_m) {
+      // the key's already in the map.
+      return pair<iterator, bool>(iterator(this, i), false);
+    }
+    // grow the table before it gets too full.
+    if ((size_m + 1) * max_load_den > capacity_m * max_load_num) {
+      _rehash(capacity_m ? capacity_m * 2 : min_capacity);
+    }
+    i = _insert_unique(h, std::forward<Args>(args)...);
+    ++inserts_m;
+    return pair<iterator, bool>(iterator(this, i), true);
+  }
+
+  // insert the entry built from args, whose key is not in
+  // the table, and return its slot. there must be a free slot.
+  template <class... Args>
+  size_type _insert_unique(size_type h, Args&&... args) {
+    size_type mask = capacity_m - 1;
+    size_type i = h & mask;
+    size_type dist = 1;
+    // look for the first slot whose entry is closer to
+    // its home than x would be, x takes over that slot.
+    while (dist_m[i] && dist_m[i] >= dist) {
+      i = (i + 1) & mask;
+      ++dist;
+    }
+    if (dist_m[i]) {
+      // shift the rest of the run one slot further,
+      // each entry moves away from its home by one.
+      size_type j = i;
+      while (dist_m[j]) {
+	j = (j + 1) & mask;
+      }
+      while (j != i) {
+	size_type prev = (j + mask) & mask;
+	new (&slots_m[j]) slot_type(std::move(slots_m[prev]));
+	slots_m[prev].~slot_type();
+	hash_m[j] = hash_m[prev];
+	dist_m[j] = dist_m[prev] + 1;
+	j = prev;
+      }
+    }
+    new (&slots_m[i]) slot_type(std::forward<Args>(args)...);
+    hash_m[i] = h;
+    dist_m[i] = dist;
+    ++size_m;
+    return i;
+  }
+
+  // erase the entry in slot i, shifting the entries
+  // after it one slot back towards their homes.
+  void _erase_at(size_type i) {
+    size_type mask = capacity_m - 1;
+    slots_m[i].~slot_type();
+    dist_m[i] = 0;
+    size_type next = (i + 1) & mask;
+    while (dist_m[next] > 1) {
+      new (&slots_m[i]) slot_type(std::move(slots_m[next]));
+      slots_m[next].~slot_type();
+      hash_m[i] = hash_m[next];
+      dist_m[i] = dist_m[next] - 1;
+      dist_m[next] = 0;
+      i = next;
+      next = (next + 1) & mask;
+    }
+    --size_m;
+  }
+
+  // index of the first occupied slot from i on,
+  // capacity_m if there's none.
+  size_type _next_occupied(size_type i) const {
+    while (i < capacity_m && !dist_m[i]) {
+      ++i;
+    }
+    return i;
+  }
+
+  // move all entries into a table with the given capacity.
+  void _rehash(size_type capacity) {
+    size_type old_capacity = capacity_m;
+    size_type* old_dist = dist_m;
+    size_type* old_hash = hash_m;
+    slot_type* old_slots = slots_m;
+    _allocate(capacity);
+    for (size_type i=0; i<old_capacity; ++i) {
+      if (old_dist[i]) {
+	_insert_unique(old_hash[i], std::move(old_slots[i]));
+	old_slots[i].~slot_type();
+      }
+    }
+    delete [] old_dist;
+    delete [] old_hash;
+    operator delete(old_slots);
+  }
+
+  // allocate an empty table. the old one is not freed.
+  void _allocate(size_type capacity) {
+    capacity_m = capacity;
+    size_m = 0;
+    dist_m = new size_type[capacity];
+    hash_m = new size_type[capacity];
+    memset(dist_m, 0, capacity * sizeof(size_type));
+    slots_m = static_cast<slot_type*>(operator new(capacity * sizeof(slot_type)));
+  }
+
+  void _copy_from(const Self& x) {
+    if (x.capacity_m == 0) return;
+    _allocate(x.capacity_m);
+    for (size_type i=0; i<capacity_m; ++i) {
+      dist_m[i] = x.dist_m[i];
+      if (dist_m[i]) {
+	new (&slots_m[i]) slot_type(x.slots_m[i]);
+	hash_m[i] = x.hash_m[i];
+      }
+    }
+    size_m = x.size_m;
+  }
+
+  void _destroy() {
+    if (capacity_m == 0) return;
+    clear();
+    delete [] dist_m;
+    delete [] hash_m;
+    operator delete(slots_m);
+    capacity_m = 0;
+    dist_m = NULL;
+    hash_m = NULL;
+    slots_m = NULL;
+  }
+
+  size_type capacity_m, size_m;
+  // probe distance of the entry in each slot plus one,
+  // zero for an empty slot.
+  size_type* dist_m;
+  // full hash value of the entry in each slot.
+  size_type* hash_m;
+  // the entries, with a key that is not const
+  // so they can be moved from slot to slot.
+  slot_type* slots_m;
+  // counters for stats(), lookups are
+  // counted from const members too.
+  size_type inserts_m;
+  mutable size_type finds_m, misses_m;
+};
+
+#endif // ROBINHOODMAP_HPP
@@ -0,0 +1,52 @@
+/**
+ * \file strhash.hpp
+ *
+ * The string hash function shared by the hash table maps. It reads
+ * the string eight bytes at a time and mixes each word in with a
+ * multiply and xor-shift, so every byte affects every bit of the result.
+ */
+
+#ifndef STRHASH_HPP
+#define STRHASH_HPP
+
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+
+/**
+ * \brief Hash the n characters starting at s.
+ * \return The hash value, using all bits of an unsigned int.
+ */
+inline unsigned int hash_string(const char* s, size_t n)
+{
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ n;
+  uint64_t k;
+  while (n >= 8) {
+    memcpy(&k, s, 8);
+    h = (h ^ k) * 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 31;
+    s += 8;
+    n -= 8;
+  }
+  // the last n < 8 bytes, with fixed size loads only.
+  if (n >= 4) {
+    uint32_t a, b;
+    memcpy(&a, s, 4);
+    memcpy(&b, s + n - 4, 4);
+    k = (static_cast<uint64_t>(a) << 32) | b;
+  }
+  else if (n > 0) {
+    k = (static_cast<uint64_t>(static_cast<unsigned char>(s[0])) << 16)
+      | (static_cast<uint64_t>(static_cast<unsigned char>(s[n >> 1])) << 8)
+      | static_cast<unsigned char>(s[n - 1]);
+  }
+  else {
+    k = 0;
+  }
+  h = (h ^ k) * 0x94d049bb133111ebULL;
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  return static_cast<unsigned int>(h ^ (h >> 32));
+}
+
+#endif // STRHASH_HPP
@@ -0,0 +1,532 @@
+/**
+ * \file swissmap.hpp
+ *
+ * A map implemented as an open addressing hash table probed sixteen
+ * slots at a time. Beside the slots there's one control byte per slot,
+ * holding seven bits of the hash of the key in it, or marking the slot
+ * empty or deleted. A lookup compares the control bytes of a whole group
+ * of sixteen slots against the hash in one SSE2 instruction, and only
+ * compares keys in the slots that match. Keys are strings. The interface
+ * is the same as hashtablemap's.
+ */
+
+#ifndef SWISSMAP_HPP
+#define SWISSMAP_HPP
+
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "mapstats.hpp"
+#include "strhash.hpp"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+template <class Key, class T>
+class swissmap
+{
+  typedef swissmap<Key, T>     Self;
+
+public:
+  typedef Key                key_type;
+  typedef T                  data_type;
+  typedef T                  mapped_type;
+  typedef pair<const Key, T> value_type;
+  typedef unsigned int       size_type;
+  typedef int                difference_type;
+
+public:
+
+  /**
+   * \class _iterator.
+   * \brief Iterator over the full slots of the table,
+   * in the order of the slots.
+   */
+  template<typename val_T, typename Base_T>
+  class _iterator {
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef val_T                     value_type;
+    typedef int                       difference_type;
+    typedef value_type*               pointer;
+    typedef value_type&               reference;
+
+    friend class swissmap;
+
+    _iterator(Base_T* map=NULL, size_type index=0): map_m(map), index_m(index) {}
+    _iterator(const _iterator& x): map_m(x.map_m), index_m(x.index_m) {}
+
+    _iterator& operator=(const _iterator& x) {
+      map_m = x.map_m;
+      index_m = x.index_m;
+      return *this;
+    }
+
+    bool operator==(const _iterator& x) const {
+      return (index_m == x.index_m);
+    }
+
+    bool operator!=(const _iterator& x) const {
+      return (index_m != x.index_m);
+    }
+
+    reference operator*() const {
+      return map_m->values_m[index_m];
+    }
+
+    pointer operator->() const {
+      return &(map_m->values_m[index_m]);
+    }
+
+    _iterator& operator++() {
+      index_m = map_m->_next_full(index_m + 1);
+      return *this;
+    }
+
+    _iterator operator++(int) {
+      _iterator ret(*this);
+      index_m = map_m->_next_full(index_m + 1);
+      return ret;
+    }
+
+  private:
+    Base_T* map_m;
+    // index of the slot, the capacity for end().
+    size_type index_m;
+  };
+
+  typedef _iterator<value_type, Self> iterator;
+  typedef _iterator<const value_type, const Self> const_iterator;
+
+public:
+  // default constructor to create an empty map,
+  // with room for m entries before growing.
+  swissmap(size_type m=0):
+    capacity_m(0), size_m(0), deleted_m(0), ctrl_m(NULL), values_m(NULL),
+    inserts_m(0), finds_m(0), misses_m(0)
+  {
+    if (m > 0) _allocate(_capacity_for(m));
+  }
+
+  // overload copy constructor to do a deep copy
+  swissmap(const Self& x):
+    capacity_m(0), size_m(0), deleted_m(0), ctrl_m(NULL), values_m(NULL),
+    inserts_m(0), finds_m(0), misses_m(0)
+  {
+    _copy_from(x);
+  }
+
+  // destructor.
+  ~swissmap() {
+    _destroy();
+  }
+
+  // overload assignment to do a deep copy
+  Self& operator=(const Self& x) {
+    // self assignment protection.
+    if (this != &x) {
+      _destroy();
+      _copy_from(x);
+    }
+    return *this;
+  }
+
+  // accessors:
+  iterator begin() {
+    return iterator(this, _next_full(0));
+  }
+  const_iterator begin() const {
+    return const_iterator(this, _next_full(0));
+  }
+  iterator end() {
+    return iterator(this, capacity_m);
+  }
+  const_iterator end() const {
+    return const_iterator(this, capacity_m);
+  }
+  bool empty() const {
+    return size_m == 0;
+  }
+  size_type size() const {
+    return size_m;
+  }
+  // number of slots in the table.
+  size_type bucket_count() const {
+    return capacity_m;
+  }
+  float load_factor() const {
+    return capacity_m ? static_cast<float>(size_m) / capacity_m : 0;
+  }
+
+  // the chain length and probe length histograms and the
+  // operation counters of the table. a chain is the set of
+  // entries with the same home group, and the probe length
+  // of an entry is the number of groups looked at to find it.
+  map_stats stats() const {
+    map_stats s;
+    s.size = size_m;
+    s.bucket_count = capacity_m / group_size;
+    s.load_factor = load_factor();
+    s.inserts = inserts_m;
+    s.finds = finds_m;
+    s.misses = misses_m;
+    std::vector<size_type> homes(s.bucket_count, 0);
+    for (size_type i=0; i<capacity_m; ++i) {
+      if (_is_full(ctrl_m[i])) {
+	size_type home = _h1(_hash_func(values_m[i].first));
+	++homes[home];
+	// groups wrap around to the start of the table.
+	size_type g = i / group_size;
+	size_type groups = (g + s.bucket_count - home) % s.bucket_count + 1;
+	add_to_histogram(s.probe_lengths, groups);
+      }
+    }
+    for (size_type i=0; i<s.bucket_count; ++i) {
+      add_to_histogram(s.chain_lengths, homes[i]);
+    }
+    summarize_probes(s);
+    return s;
+  }
+
+  // insert/erase
+  pair<iterator,bool> insert(const value_type& x) {
+    return _emplace_key(x.first, x);
+  }
+
+  // insert key k with the value built from args, if k's not
+  // in the map yet. nothing is built or moved otherwise.
+  template <class... Args>
+  pair<iterator,bool> try_emplace(const Key& k, Args&&... args) {
+    return _emplace_key(k, piecewise_construct, forward_as_tuple(k),
+			forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  template <class... Args>
+  pair<iterator,bool> try_emplace(Key&& k, Args&&... args) {
+    return _emplace_key(k, piecewise_construct, forward_as_tuple(std::move(k)),
+			forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  void erase(iterator pos) {
+    _erase_at(pos.index_m);
+  }
+
+  size_type erase(const Key& x) {
+    size_type i = _find(x, _hash_func(x));
+    if (i == capacity_m) {
+      // the key's not found.
+      return 0;
+    }
+    _erase_at(i);
+    return 1;
+  }
+
+  void clear() {
+    for (size_type i=0; i<capacity_m; ++i) {
+      if (_is_full(ctrl_m[i])) {
+	values_m[i].~value_type();
+      }
+      ctrl_m[i] = ctrl_empty;
+    }
+    size_m = 0;
+    deleted_m = 0;
+  }
+
+  // make room for at least m entries.
+  void reserve(size_type m) {
+    size_type capacity = _capacity_for(m);
+    if (capacity > capacity_m) _rehash(capacity);
+  }
+
+  // map operations:
+  iterator find(const Key& x) {
+    return iterator(this, _find(x, _hash_func(x)));
+  }
+
+  const_iterator find(const Key& x) const {
+    return const_iterator(this, _find(x, _hash_func(x)));
+  }
+
+  // look up by a view of the key, no string is made.
+  iterator find(string_view x) {
+    return iterator(this, _find(x, _hash_func(x)));
+  }
+
+  const_iterator find(string_view x) const {
+    return const_iterator(this, _find(x, _hash_func(x)));
+  }
+
+  iterator find(const char* x) {
+    return find(string_view(x));
+  }
+
+  const_iterator find(const char* x) const {
+    return find(string_view(x));
+  }
+
+  size_type count(const Key& x) const {
+    return count(string_view(x));
+  }
+
+  size_type count(string_view x) const {
+    if (_find(x, _hash_func(x)) != capacity_m) {
+      return 1;
+    }
+    else {
+      return 0;
+    }
+  }
+
+  size_type count(const char* x) const {
+    return count(string_view(x));
+  }
+
+  // if the key's not found, insert
+  // it with default init value.
+  T& operator[](const Key& k) {
+    return try_emplace(k).first->second;
+  }
+
+  T& operator[](Key&& k) {
+    return try_emplace(std::move(k)).first->second;
+  }
+
+private:
+  // the table is rehashed when more than 7/8 of it is used.
+  enum { max_load_num = 7, max_load_den = 8, group_size = 16 };
+
+  // control bytes of empty and deleted slots. a full slot
+  // holds the low seven bits of its hash, so its top bit is 0.
+  static const signed char ctrl_empty = -128;
+  static const signed char ctrl_deleted = -2;
+
+  static bool _is_full(signed char c) {
+    return c >= 0;
+  }
+
+  // hash function. currently only work for string.
+  static size_type _hash_func(string_view key) {
+    return hash_string(key.data(), key.size());
+  }
+
+  // the group to start probing from, and the control byte.
+  // they use different bits of the hash.
+  size_type _h1(size_type h) const {
+    return (h >> 7) & (capacity_m / group_size - 1);
+  }
+  static signed char _h2(size_type h) {
+    return static_cast<signed char>(h & 0x7f);
+  }
+
+  // bit i of the result is set iff control byte i
+  // of the group starting at slot g equals c.
+  unsigned int _match(size_type g, signed char c) const {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl_m + g));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(c)));
+#else
+    unsigned int mask = 0;
+    for (size_type i=0; i<group_size; ++i) {
+      if (ctrl_m[g + i] == c) mask |= 1u << i;
+    }
+    return mask;
+#endif
+  }
+
+  // bit i of the result is set iff slot i of the
+  // group starting at slot g is empty or deleted.
+  unsigned int _match_free(size_type g) const {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl_m + g));
+    return _mm_movemask_epi8(ctrl);
+#else
+    unsigned int mask = 0;
+    for (size_type i=0; i<group_size; ++i) {
+      if (!_is_full(ctrl_m[g + i])) mask |= 1u << i;
+    }
+    return mask;
+#endif
+  }
+
+  // index of the lowest set bit of a non zero mask.
+  static size_type _lowest_bit(unsigned int mask) {
+    return __builtin_ctz(mask);
+  }
+
+  // smallest power of two capacity holding m entries.
+  size_type _capacity_for(size_type m) const {
+    size_type capacity = group_size;
+    while (m * max_load_den > capacity * max_load_num) {
+      capacity *= 2;
+    }
+    return capacity;
+  }
+
+  // find the slot of key x with hash h.
+  // return capacity_m if it is not found.
+  size_type _find(string_view x, size_type h) const {
+    ++finds_m;
+    if (capacity_m == 0) {
+      ++misses_m;
+      return capacity_m;
+    }
+    size_type group_mask = capacity_m / group_size - 1;
+    size_type g = _h1(h);
+    signed char c = _h2(h);
+    // probe the groups one after another, until
+    // reaching a group with an empty slot.
+    for (size_type probes=0; probes<=group_mask; ++probes) {
+      size_type base = g * group_size;
+      unsigned int mask = _match(base, c);
+      while (mask) {
+	size_type i = base + _lowest_bit(mask);
+	if (values_m[i].first == x) return i;
+	mask &= mask - 1;
+      }
+      if (_match(base, ctrl_empty)) break;
+      g = (g + 1) & group_mask;
+    }
+    ++misses_m;
+    return capacity_m;
+  }
+
+  // insert the entry built from args, whose key is
+  // k, if k's not in the map yet.
+  template <class... Args>
+  pair<iterator,bool> _emplace_key(string_view k, Args&&... args) {
+    size_type h = _hash_func(k);
+    size_type i = _find(k, h);
+    if (i != capacity_m) {
+      // the key's already in the map.
+      return pair<iterator, bool>(iterator(this, i), false);
+    }
+    // deleted slots count as used, a table full of
+    // them is rehashed at the same size to clear them.
+    if ((size_m + deleted_m + 1) * max_load_den > capacity_m * max_load_num) {
+      if (capacity_m == 0) {
+	_rehash(group_size);
+      }
+      else if ((size_m + 1) * 2 * max_load_den > capacity_m * max_load_num) {
+	_rehash(capacity_m * 2);
+      }
+      else {
+	_rehash(capacity_m);
+      }
+    }
+    i = _insert_unique(h, std::forward<Args>(args)...);
+    ++inserts_m;
+    return pair<iterator, bool>(iterator(this, i), true);
+  }
+
+  // insert the entry built from args, whose key is not in the
+  // table, into the first free slot along its probe sequence,
+  // and return the slot.
+  template <class... Args>
+  size_type _insert_unique(size_type h, Args&&... args) {
+    size_type group_mask = capacity_m / group_size - 1;
+    size_type g = _h1(h);
+    unsigned int mask = _match_free(g * group_size);
+    while (!mask) {
+      g = (g + 1) & group_mask;
+      mask = _match_free(g * group_size);
+    }
+    size_type i = g * group_size + _lowest_bit(mask);
+    if (ctrl_m[i] == ctrl_deleted) --deleted_m;
+    new (&values_m[i]) value_type(std::forward<Args>(args)...);
+    ctrl_m[i] = _h2(h);
+    ++size_m;
+    return i;
+  }
+
+  void _erase_at(size_type i) {
+    values_m[i].~value_type();
+    // a probe may have passed this slot on its way to
+    // a key further on, so it can't be marked empty.
+    ctrl_m[i] = ctrl_deleted;
+    ++deleted_m;
+    --size_m;
+  }
+
+  // index of the first full slot from i on,
+  // capacity_m if there's none.
+  size_type _next_full(size_type i) const {
+    while (i < capacity_m && !_is_full(ctrl_m[i])) {
+      ++i;
+    }
+    return i;
+  }
+
+  // move all entries into a table with the given capacity.
+  void _rehash(size_type capacity) {
+    size_type old_capacity = capacity_m;
+    signed char* old_ctrl = ctrl_m;
+    value_type* old_values = values_m;
+    _allocate(capacity);
+    for (size_type i=0; i<old_capacity; ++i) {
+      if (_is_full(old_ctrl[i])) {
+	_insert_unique(_hash_func(old_values[i].first), old_values[i]);
+	old_values[i].~value_type();
+      }
+    }
+    if (old_ctrl != NULL) _free(old_ctrl);
+    operator delete(old_values);
+  }
+
+  // allocate an empty table. the old one is not freed.
+  void _allocate(size_type capacity) {
+    capacity_m = capacity;
+    size_m = 0;
+    deleted_m = 0;
+    // control bytes are loaded a group at a time,
+    // so they are aligned to the group size.
+    char* raw = new char[capacity + group_size];
+    size_t offset = group_size - reinterpret_cast<size_t>(raw) % group_size;
+    ctrl_m = reinterpret_cast<signed char*>(raw + offset);
+    // the byte before the control bytes keeps the offset to free them.
+    ctrl_m[-1] = static_cast<signed char>(offset);
+    memset(ctrl_m, ctrl_empty, capacity);
+    values_m = static_cast<value_type*>(operator new(capacity * sizeof(value_type)));
+  }
+
+  static void _free(signed char* ctrl) {
+    delete [] (reinterpret_cast<char*>(ctrl) - ctrl[-1]);
+  }
+
+  void _copy_from(const Self& x) {
+    if (x.capacity_m == 0) return;
+    _allocate(x.capacity_m);
+    for (size_type i=0; i<capacity_m; ++i) {
+      ctrl_m[i] = x.ctrl_m[i];
+      if (_is_full(ctrl_m[i])) {
+	new (&values_m[i]) value_type(x.values_m[i]);
+      }
+    }
+    size_m = x.size_m;
+    deleted_m = x.deleted_m;
+  }
+
+  void _destroy() {
+    if (capacity_m == 0) return;
+    clear();
+    _free(ctrl_m);
+    operator delete(values_m);
+    capacity_m = 0;
+    ctrl_m = NULL;
+    values_m = NULL;
+  }
+
+  size_type capacity_m, size_m, deleted_m;
+  signed char* ctrl_m;
+  value_type* values_m;
+  // counters for stats(), lookups are
+  // counted from const members too.
+  size_type inserts_m;
+  mutable size_type finds_m, misses_m;
+};
+
+#endif // SWISSMAP_HPP